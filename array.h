@@ -7,19 +7,21 @@
 
 namespace ara3d
 {
-	typedef __int64 ptrdiff_t;
+	typedef decltype(sizeof(0)) size_t;
+	typedef decltype((char*)0 - (char*)0) ptrdiff_t;
 
 	// Iterator for accessing of items at fixed byte offsets in memory 
 	template<typename T, size_t OffsetN = sizeof(T)>
-	class mem_stride_iterator
+	struct mem_stride_iterator
 	{
-		typedef T ValueType;
+		typedef T value_type;
 
 		const char* _data;
 
 		const T& operator*() const { return *(T*)_data; }
 		T& operator*() { return *(T*)_data; }
 		mem_stride_iterator(const char* data = nullptr) : _data(data) { }
+		mem_stride_iterator(const T* data) : _data((const char*)data) { }
 		bool operator==(const mem_stride_iterator iter) const { return _data == iter._data; }
 		bool operator!=(const mem_stride_iterator iter) const { return _data != iter._data; }
 		mem_stride_iterator& operator++() { _data += OffsetN; return *this; }
@@ -33,13 +35,14 @@ namespace ara3d
 
 	// Iterator for read-only access of items at fixed byte offsets in memory 
 	template<typename T, size_t OffsetN = sizeof(T)>
-	class const_mem_stride_iterator
+	struct const_mem_stride_iterator
 	{
-		typedef T ValueType;
+		typedef T value_type;
 
 		const char* _data;
 
 		const_mem_stride_iterator(const char* data = nullptr) : _data(data) { }
+		const_mem_stride_iterator(const T* data) : _data((const char*)data) { }
 		const_mem_stride_iterator(mem_stride_iterator<T, OffsetN> other) : _data(other._data) { }
 		const T& operator*() const { return *(T*)_data; }
 		bool operator==(const const_mem_stride_iterator iter) const { return _data == iter._data; }
@@ -52,26 +55,54 @@ namespace ara3d
 		const T& operator[](size_t n) const { return *(const T*)(_data + OffsetN * n); }
 	};
 
-	// Iterator that generating items as needed using a function 
+	// Names a value of type T in unevaluated expressions, such as the operand of decltype. It is never defined.
+	template<typename T>
+	const T& declare_const();
+
+	// The type of a value with references and const removed, as returned from a function by value
+	template<typename T> struct value_of { typedef T type; };
+	template<typename T> struct value_of<const T> { typedef T type; };
+	template<typename T> struct value_of<T&> { typedef typename value_of<T>::type type; };
+	template<typename T> struct value_of<T&&> { typedef typename value_of<T>::type type; };
+
+	// Holds a function object. Empty function objects, such as lambdas without captures, are held as a base class
+	// so they take up no space (the empty base optimization).
+	template<typename F, bool Empty = __is_empty(F)>
+	struct func_holder
+	{
+		F _func;
+		func_holder(const F& func) : _func(func) { }
+		const F& func() const { return _func; }
+	};
+
 	template<typename F>
-	struct func_array_iterator
+	struct func_holder<F, true> : private F
 	{
-		typedef typename F::result_type value_type;
+		func_holder(const F& func) : F(func) { }
+		const F& func() const { return *this; }
+	};
+
+	// Iterator that generating items as needed using a function. The function can be any callable taking an index, 
+	// such as a lambda, a function object, or a function pointer, and the item type is what it returns.
+	template<typename F>
+	struct func_array_iterator : private func_holder<F>
+	{
+		typedef typename value_of<decltype(declare_const<F>()(size_t()))>::type value_type;
 		typedef F func_type;
 
-		F _func;
 		size_t _i;
 
-		func_array_iterator(const F& func, size_t i = 0) : _func(func), _i(i) { }
-		value_type operator*() const { return _func(_i); }
+		func_array_iterator(const F& func, size_t i = 0) : func_holder<F>(func), _i(i) { }
+		const F& func() const { return func_holder<F>::func(); }
+		value_type operator*() const { return func()(_i); }
 		bool operator==(const func_array_iterator iter) const { return _i == iter._i; }
 		bool operator!=(const func_array_iterator iter) const { return _i != iter._i; }
 		func_array_iterator& operator++() { return this->operator+=(1); }
-		func_array_iterator operator++(int) { func_array_iterator r = *this; (*this)++; return r; }
+		func_array_iterator operator++(int) { func_array_iterator r = *this; ++*this; return r; }
 		func_array_iterator& operator+=(size_t n) { _i += n; return *this; }
-		func_array_iterator operator+(size_t n) const { return func_array_iterator(_func, _i + n); }
+		func_array_iterator operator+(size_t n) const { return func_array_iterator(func(), _i + n); }
 		ptrdiff_t operator-(const func_array_iterator& iter) const { return _i - iter._i; }
-		value_type operator[](size_t n) const { return _func(_i + n); }
+		value_type operator[](size_t n) const { return func()(_i + n); }
 	};
 
 	// A wrapper around an existing iterator that advances it by N items at a time. 
@@ -97,6 +128,14 @@ namespace ara3d
 		value_type operator[](size_t n) const { return _iter[n * _stride]; }
 	};
 
+	// The result of indexing a read-only array: a const reference to items that are stored, 
+	// and a value for items that are computed by the iterator, which would otherwise be a dangling reference.
+	template<typename R, typename T>
+	struct const_reference_of { typedef T type; };
+
+	template<typename R, typename T>
+	struct const_reference_of<R&, T> { typedef const T& type; };
+
 	// The base class of all const array implementations 
 	template<
 		typename T, 
@@ -108,6 +147,7 @@ namespace ara3d
 		typedef IterT const_iterator;
 		typedef T value_type;
 		typedef size_t size_type;
+		typedef typename const_reference_of<decltype(declare_const<IterT>()[0]), T>::type const_reference;
 
 		iterator _iter;
 		size_t _size;
@@ -115,7 +155,7 @@ namespace ara3d
 		const_array_base(iterator begin, size_t size = 0) : _iter(begin), _size(size) { }
 		iterator begin() const { return _iter; }
 		iterator end() const { return begin() + size(); }
-		const value_type& operator[](size_t n) const { return begin()[n]; }
+		const_reference operator[](size_t n) const { return begin()[n]; }
 		size_type size() const { return _size; }
 		bool empty() const { return size() == 0; }
 	};
@@ -182,7 +222,7 @@ namespace ara3d
 	>
 	struct const_array_stride : public BaseT
 	{
-		const_array_stride(typename ArrayT::iterator begin = ArrayT::iterator(), size_t size = 0, size_t stride = 0) : const_array_base(IterT(begin, stride), size) { }
+		const_array_stride(typename ArrayT::iterator begin = typename ArrayT::iterator(), size_t size = 0, size_t stride = 0) : BaseT(IterT(begin, stride), size) { }
 	};
 
 	// A mutable view into a contiguous buffer of data without ownership semantics and which can be indexed and sliced. 
@@ -205,6 +245,7 @@ namespace ara3d
 	struct const_array_view : public BaseT
 	{
 		const_array_view(IterT begin = IterT(), size_t size = 0) : BaseT(begin, size) { }
+		const_array_view(const array_base<ValueT, ValueT*, const ValueT*>& other) : BaseT(other.begin(), other.size()) { }
 	};
 
 	// An immutable view of a set of values that are in a contigous block of memory, but offset from each other a fixed number of bytes	
@@ -226,26 +267,684 @@ namespace ara3d
 		typename ConstIterT = const_mem_stride_iterator <ValueT, OffsetN >, 
 		typename BaseT = array_base<ValueT, IterT, ConstIterT >
 	>
-	struct array_mem_stride : public BaseT, ConstIterT
+	struct array_mem_stride : public BaseT
 	{
-		array_mem_stride(const ValueT* begin = nullptr, size_t size = 0) : BaseT(IterT(begin), size) { }
+		array_mem_stride(ValueT* begin = nullptr, size_t size = 0) : BaseT(IterT(begin), size) { }
 	};
 	
-	// Provides an array interface around a function and a size. Requires functors or std::function to work. 
-	template<typename F, typename ValueT = typename F::result_type, typename IterT = func_array_iterator<F>, typename BaseT = const_array_base<ValueT, IterT>>
+	template<typename T, typename BaseT = array_view<T>>
+	struct array;
+
+	// Detects whether a function object or an array provides `read(first, count, out)` for items of type T, which 
+	// computes many items at once. The call expression is checked, so overloaded and inherited members are found.
+	template<typename F, typename T>
+	struct has_batch_read
+	{
+		template<typename U> static char test(decltype(declare_const<U>().read(size_t(), size_t(), (T*)nullptr))*);
+		template<typename U> static long test(...);
+		static const bool value = sizeof(test<F>(nullptr)) == 1;
+	};
+
+	template<bool B>
+	struct bool_constant { };
+
+	// Provides an array interface around a function and a size. The function can be any callable taking an index: 
+	// lambdas are stored directly, so calls to them inline, unlike calls through std::function. 
+	// A function object may also provide `void read(size_t first, size_t count, value_type* out) const` to compute 
+	// a range of items in one call, typically as a closed form loop that the compiler vectorizes. 
+	template<typename F, typename ValueT = typename func_array_iterator<F>::value_type, typename IterT = func_array_iterator<F>, typename BaseT = const_array_base<ValueT, IterT>>
 	struct func_array : public BaseT 
 	{	
 		func_array(F func, size_t size) : BaseT(IterT(func), size) { }
+
+		const F& func() const { return BaseT::_iter.func(); }
+
+		// Writes the items [first, first + count) to `out`
+		void read(size_t first, size_t count, ValueT* out) const { read(first, count, out, bool_constant<has_batch_read<F, ValueT>::value>()); }
+
+		// Computes every item into a new array
+		array<ValueT> to_array() const
+		{
+			array<ValueT> r(BaseT::size());
+			read(0, r.size(), r.begin());
+			return r;
+		}
+
+	private:
+		void read(size_t first, size_t count, ValueT* out, bool_constant<true>) const { func().read(first, count, out); }
+		void read(size_t first, size_t count, ValueT* out, bool_constant<false>) const { for (size_t i = 0; i < count; ++i) out[i] = func()(first + i); }
+	};
+
+	// Creates a func_array from a size and any callable, deducing the types: e.g. `make_func_array(n, [](size_t i) { return i * i; })`
+	template<typename F>
+	func_array<F> make_func_array(size_t size, F func)
+	{
+		return func_array<F>(func, size);
+	}
+
+	// Computes the arithmetic sequence start, start + step, start + step * 2, ...
+	template<typename T>
+	struct iota_func
+	{
+		typedef T result_type;
+		T start, step;
+		T operator()(size_t i) const { return start + step * (T)i; }
+		void read(size_t first, size_t count, T* out) const { for (size_t i = 0; i < count; ++i) out[i] = start + step * (T)(first + i); }
 	};
 
+	template<typename T>
+	struct iota_array : public func_array<iota_func<T>>
+	{
+		iota_array(size_t size = 0, T start = T(0), T step = T(1)) : func_array<iota_func<T>>(iota_func<T>{ start, step }, size) { }
+		T start() const { return this->func().start; }
+		T step() const { return this->func().step; }
+	};
+
+	// Computes the same value for every item
+	template<typename T>
+	struct constant_func
+	{
+		typedef T result_type;
+		T value;
+		T operator()(size_t) const { return value; }
+		void read(size_t, size_t count, T* out) const { for (size_t i = 0; i < count; ++i) out[i] = value; }
+	};
+
+	template<typename T>
+	struct constant_array : public func_array<constant_func<T>>
+	{
+		constant_array(size_t size = 0, T value = T()) : func_array<constant_func<T>>(constant_func<T>{ value }, size) { }
+		T value() const { return this->func().value; }
+	};
+
+	// Computes evenly spaced floating point values from start to stop, ending exactly on stop. A single value is start.
+	template<typename T>
+	struct linspace_func
+	{
+		typedef T result_type;
+		T start, stop, step;
+		size_t last;
+		T operator()(size_t i) const { return i == last ? stop : start + step * (T)i; }
+		void read(size_t first, size_t count, T* out) const
+		{
+			for (size_t i = 0; i < count; ++i) out[i] = start + step * (T)(first + i);
+			if (first <= last && last < first + count) out[last - first] = stop;
+		}
+	};
+
+	template<typename T>
+	struct linspace_array : public func_array<linspace_func<T>>
+	{
+		linspace_array(size_t size = 0, T start = T(0), T stop = T(1)) 
+			: func_array<linspace_func<T>>(linspace_func<T>{ start, stop, size > 1 ? (stop - start) / (T)(size - 1) : T(0), size > 1 ? size - 1 : (size_t)-1 }, size) 
+		{ }
+		T start() const { return this->func().start; }
+		T stop() const { return this->func().stop; }
+	};
+
+	// Computes each value of a source array `times` times in a row: a a b b c c
+	template<typename T>
+	struct repeat_func
+	{
+		typedef T result_type;
+		const T* values;
+		size_t times;
+		T operator()(size_t i) const { return values[i / times]; }
+		void read(size_t first, size_t count, T* out) const
+		{
+			for (size_t i = 0; i < count; ) {
+				const T value = values[(first + i) / times];
+				const size_t run = times - (first + i) % times;
+				const size_t end = run < count - i ? i + run : count;
+				for (; i < end; ++i) out[i] = value;
+			}
+		}
+	};
+
+	template<typename T>
+	struct repeat_array : public func_array<repeat_func<T>>
+	{
+		repeat_array(const T* values = nullptr, size_t count = 0, size_t times = 1) : func_array<repeat_func<T>>(repeat_func<T>{ values, times }, count * times) { }
+		repeat_array(const const_array_view<T>& values, size_t times) : repeat_array(values.begin(), values.size(), times) { }
+		const_array_view<T> values() const { return const_array_view<T>(this->func().values, this->size() / this->func().times); }
+		size_t times() const { return this->func().times; }
+	};
+
+	// Computes the values of a source array over and over: a b c a b c
+	template<typename T>
+	struct cycle_func
+	{
+		typedef T result_type;
+		const T* values;
+		size_t period;
+		T operator()(size_t i) const { return values[i % period]; }
+		void read(size_t first, size_t count, T* out) const
+		{
+			for (size_t i = 0, j = first % period; i < count; j = 0) {
+				const size_t end = period - j < count - i ? i + period - j : count;
+				for (; i < end; ++i, ++j) out[i] = values[j];
+			}
+		}
+	};
+
+	template<typename T>
+	struct cycle_array : public func_array<cycle_func<T>>
+	{
+		cycle_array(const T* values = nullptr, size_t period = 1, size_t size = 0) : func_array<cycle_func<T>>(cycle_func<T>{ values, period }, size) { }
+		cycle_array(const const_array_view<T>& values, size_t size) : cycle_array(values.begin(), values.size(), size) { }
+		const_array_view<T> values() const { return const_array_view<T>(this->func().values, this->func().period); }
+	};
+
+	// The sum of the items of any array. Computed arrays with a closed form overload this. 
+	template<typename ArrayT>
+	typename ArrayT::value_type sum(const ArrayT& xs)
+	{
+		typename ArrayT::value_type r = typename ArrayT::value_type();
+		for (size_t i = 0; i < xs.size(); ++i) r += xs[i];
+		return r;
+	}
+
+	template<typename T>
+	T sum(const iota_array<T>& xs)
+	{
+		const size_t n = xs.size();
+		return xs.start() * (T)n + xs.step() * (T)(n % 2 == 0 ? n / 2 * (n - 1) : (n - 1) / 2 * n);
+	}
+
+	template<typename T>
+	T sum(const constant_array<T>& xs)
+	{
+		return xs.value() * (T)xs.size();
+	}
+
+	template<typename T>
+	T sum(const linspace_array<T>& xs)
+	{
+		return xs.size() < 2 ? (xs.size() == 0 ? T(0) : xs.start()) : (xs.start() + xs.stop()) * (T)xs.size() / T(2);
+	}
+
+	template<typename T>
+	T sum(const repeat_array<T>& xs)
+	{
+		return sum(xs.values()) * (T)xs.times();
+	}
+
+	template<typename T>
+	T sum(const cycle_array<T>& xs)
+	{
+		const const_array_view<T> values = xs.values();
+		const size_t n = xs.size(), period = values.size();
+		if (n == 0) return T();
+		return sum(values) * (T)(n / period) + sum(const_array_view<T>(values.begin(), n % period));
+	}
+
 	// An array container (owns memory) with a run-time defined size. 
-	template<typename T, typename BaseT = array_view<T>>
+	// Memory comes from new[] unless it was adopted together with a function to release it.
+	template<typename T, typename BaseT>
 	struct array : public BaseT
 	{
-		array(size_t size = 0) : BaseT(new T[size], size) { }	
-		~array() { delete[] BaseT::begin(); }
+		typedef void (*release_func)(T* data, size_t size);
+
+		release_func _release;
+
+		array(size_t size = 0) : BaseT(new T[size], size), _release(nullptr) { }	
+		array(T* data, size_t size, release_func release) : BaseT(data, size), _release(release) { }
+		array(array&& other) : BaseT(other._iter, other._size), _release(other._release) { other._iter = nullptr; other._size = 0; }
+		array(const array&) = delete;
+		array& operator=(array&& other) { if (this != &other) { release(); BaseT::_iter = other._iter; BaseT::_size = other._size; _release = other._release; other._iter = nullptr; other._size = 0; } return *this; }
+		array& operator=(const array&) = delete;
+		~array() { release(); }
+
+	private:
+		void release() { if (_release) _release(BaseT::_iter, BaseT::_size); else delete[] BaseT::_iter; }
 	};
 
 	// An array of bytes 
 	typedef array<unsigned char> buffer;
-}
\ No newline at end of file
+
+	// A resizable array that stores up to N items inside the object, and only allocates from the heap when it grows beyond that.
+	// It is an array_view, so it can be passed anywhere a view is expected, but views into it are invalidated when it grows or moves.
+	template<typename T, size_t N, typename BaseT = array_view<T>>
+	struct small_array : public BaseT
+	{
+		static_assert(N > 0, "small_array needs room for at least one item");
+
+		T _inline[N];
+		T* _heap;
+		size_t _capacity;
+
+		small_array(size_t size = 0) : BaseT(_inline, 0), _heap(nullptr), _capacity(N) { resize(size); }
+		small_array(const small_array& other) : BaseT(_inline, 0), _heap(nullptr), _capacity(N) { assign(other.begin(), other.size()); }
+		small_array(small_array&& other) : BaseT(_inline, 0), _heap(nullptr), _capacity(N) { take(other); }
+		small_array& operator=(const small_array& other) { if (this != &other) { BaseT::_size = 0; assign(other.begin(), other.size()); } return *this; }
+		small_array& operator=(small_array&& other) { if (this != &other) { BaseT::_size = 0; take(other); } return *this; }
+		~small_array() { delete[] _heap; }
+
+		size_t capacity() const { return _capacity; }
+		bool is_inline() const { return _heap == nullptr; }
+
+		void reserve(size_t capacity)
+		{
+			if (capacity <= _capacity) return;
+			T* heap = new T[capacity];
+			for (size_t i = 0; i < BaseT::_size; ++i) heap[i] = static_cast<T&&>(BaseT::_iter[i]);
+			delete[] _heap;
+			_heap = heap;
+			_capacity = capacity;
+			BaseT::_iter = heap;
+		}
+
+		void resize(size_t size)
+		{
+			if (size > _capacity) reserve(size > _capacity * 2 ? size : _capacity * 2);
+			for (size_t i = BaseT::_size; i < size; ++i) BaseT::_iter[i] = T();
+			BaseT::_size = size;
+		}
+
+		void push_back(const T& value)
+		{
+			if (BaseT::_size == _capacity) {
+				// The value may refer to an item of this array, which is invalidated by growing
+				T copy(value);
+				reserve(_capacity * 2);
+				BaseT::_iter[BaseT::_size++] = static_cast<T&&>(copy);
+			}
+			else BaseT::_iter[BaseT::_size++] = value;
+		}
+
+		void pop_back() { --BaseT::_size; }
+		void clear() { BaseT::_size = 0; }
+
+	private:
+		void assign(const T* values, size_t size)
+		{
+			reserve(size);
+			for (size_t i = 0; i < size; ++i) BaseT::_iter[i] = values[i];
+			BaseT::_size = size;
+		}
+
+		void take(small_array& other)
+		{
+			if (other._heap) {
+				delete[] _heap;
+				_heap = other._heap;
+				_capacity = other._capacity;
+				BaseT::_iter = _heap;
+				BaseT::_size = other._size;
+				other._heap = nullptr;
+				other._capacity = N;
+				other._iter = other._inline;
+			}
+			else {
+				reserve(other._size);
+				for (size_t i = 0; i < other._size; ++i) BaseT::_iter[i] = static_cast<T&&>(other._inline[i]);
+				BaseT::_size = other._size;
+			}
+			other._size = 0;
+		}
+	};
+
+	// The default storage of a `dynamic_array`: buffers come from new[] and are released with delete[].
+	// A storage policy moves the items into a buffer of a new capacity, releases buffers, and hands them over to an `array`.
+	template<typename T>
+	struct heap_storage
+	{
+		// Moves the first `size` items into a buffer of at least `capacity` items and releases the old buffer.
+		// Returns the new buffer, and sets `capacity` to the number of items it holds.
+		T* reallocate(T* data, size_t size, size_t /*old_capacity*/, size_t& capacity)
+		{
+			T* r = capacity ? new T[capacity] : nullptr;
+			for (size_t i = 0; i < size; ++i) r[i] = static_cast<T&&>(data[i]);
+			delete[] data;
+			return r;
+		}
+
+		void release(T* data, size_t /*capacity*/) { delete[] data; }
+
+		// Transfers a buffer to an array, which keeps any unused capacity
+		array<T> finish(T* data, size_t size, size_t /*capacity*/) { return array<T>(data, size, nullptr); }
+	};
+
+	// A growable array for building up data whose size is not known in advance, which can then be turned into an `array`
+	// without copying. Capacity grows by a configurable factor. Memory comes from the storage policy: `heap_storage` by
+	// default, or `mapped_storage` from `array_mapped.h`, which grows large buffers by remapping pages instead of copying.
+	template<typename T, typename BaseT = array_view<T>, typename StorageT = heap_storage<T>>
+	struct dynamic_array : public BaseT
+	{
+		size_t _capacity;
+		float _growth_factor;
+		StorageT _storage;
+
+		dynamic_array(size_t capacity = 0, float growth_factor = 2.0f) : BaseT(nullptr, 0), _capacity(0), _growth_factor(growth_factor), _storage() { reserve(capacity); }
+		dynamic_array(dynamic_array&& other) : BaseT(other._iter, other._size), _capacity(other._capacity), _growth_factor(other._growth_factor), _storage(other._storage) { other.forget(); }
+		dynamic_array(const dynamic_array&) = delete;
+		dynamic_array& operator=(dynamic_array&& other) { if (this != &other) { release(); BaseT::_iter = other._iter; BaseT::_size = other._size; _capacity = other._capacity; _growth_factor = other._growth_factor; _storage = other._storage; other.forget(); } return *this; }
+		dynamic_array& operator=(const dynamic_array&) = delete;
+		~dynamic_array() { release(); }
+
+		size_t capacity() const { return _capacity; }
+		float growth_factor() const { return _growth_factor; }
+		void set_growth_factor(float growth_factor) { _growth_factor = growth_factor; }
+
+		void reserve(size_t capacity)
+		{
+			if (capacity > _capacity) reallocate(capacity);
+		}
+
+		void resize(size_t size)
+		{
+			if (size > _capacity) grow(size);
+			for (size_t i = BaseT::_size; i < size; ++i) BaseT::_iter[i] = T();
+			BaseT::_size = size;
+		}
+
+		void push_back(const T& value)
+		{
+			if (BaseT::_size == _capacity) {
+				// The value may refer to an item of this array, which is invalidated by growing
+				T copy(value);
+				grow(BaseT::_size + 1);
+				BaseT::_iter[BaseT::_size++] = static_cast<T&&>(copy);
+			}
+			else BaseT::_iter[BaseT::_size++] = value;
+		}
+
+		// Moves an item in, so move-only items such as `array` can be stored
+		void push_back(T&& value)
+		{
+			if (BaseT::_size == _capacity) {
+				T moved(static_cast<T&&>(value));
+				grow(BaseT::_size + 1);
+				BaseT::_iter[BaseT::_size++] = static_cast<T&&>(moved);
+			}
+			else BaseT::_iter[BaseT::_size++] = static_cast<T&&>(value);
+		}
+
+		void append(const T* values, size_t count)
+		{
+			if (BaseT::_size + count > _capacity) grow(BaseT::_size + count);
+			for (size_t i = 0; i < count; ++i) BaseT::_iter[BaseT::_size + i] = values[i];
+			BaseT::_size += count;
+		}
+
+		void pop_back() { --BaseT::_size; }
+		void clear() { BaseT::_size = 0; }
+
+		// Releases unused capacity, by moving the items into a buffer of the exact size or, for mapped storage, in place
+		void shrink_to_fit()
+		{
+			if (BaseT::_size < _capacity) reallocate(BaseT::_size);
+		}
+
+		// Transfers the items to an array, leaving this empty. The buffer is handed over as is: heap buffers keep their
+		// unused capacity (call `shrink_to_fit` first to trim it), while mapped buffers are shrunk to size for free.
+		array<T> finish()
+		{
+			if (!BaseT::_iter) return array<T>();
+			array<T> r = _storage.finish(BaseT::_iter, BaseT::_size, _capacity);
+			forget();
+			return r;
+		}
+
+	private:
+		void grow(size_t required)
+		{
+			size_t capacity = (size_t)(_capacity * (double)_growth_factor);
+			if (capacity < _capacity + 4) capacity = _capacity + 4;
+			reallocate(capacity < required ? required : capacity);
+		}
+
+		void reallocate(size_t capacity)
+		{
+			BaseT::_iter = _storage.reallocate(BaseT::_iter, BaseT::_size, _capacity, capacity);
+			_capacity = capacity;
+		}
+
+		void release() { if (BaseT::_iter) _storage.release(BaseT::_iter, _capacity); }
+
+		void forget() { BaseT::_iter = nullptr; BaseT::_size = 0; _capacity = 0; _storage = StorageT(); }
+	};
+
+	// Iterator over the items of a segmented_array, which locates each item with a shift and a mask 
+	template<typename T, size_t ChunkBits, typename RefT = T&>
+	struct segmented_iterator
+	{
+		typedef T value_type;
+
+		T* const* _chunks;
+		size_t _i;
+
+		segmented_iterator(T* const* chunks = nullptr, size_t i = 0) : _chunks(chunks), _i(i) { }
+		segmented_iterator(const segmented_iterator<T, ChunkBits>& other) : _chunks(other._chunks), _i(other._i) { }
+		RefT operator*() const { return _chunks[_i >> ChunkBits][_i & (((size_t)1 << ChunkBits) - 1)]; }
+		bool operator==(const segmented_iterator iter) const { return _i == iter._i; }
+		bool operator!=(const segmented_iterator iter) const { return _i != iter._i; }
+		segmented_iterator& operator++() { ++_i; return *this; }
+		segmented_iterator operator++(int) { segmented_iterator r = *this; ++_i; return r; }
+		segmented_iterator& operator+=(size_t n) { _i += n; return *this; }
+		segmented_iterator operator+(size_t n) const { return segmented_iterator(_chunks, _i + n); }
+		ptrdiff_t operator-(const segmented_iterator& iter) const { return _i - iter._i; }
+		RefT operator[](size_t n) const { return *(*this + n); }
+	};
+
+	// An append-only array stored in fixed size chunks of 2^ChunkBits items. Appending never moves existing items, so
+	// their addresses stay valid and growth never needs a second copy of the data. Each chunk can be accessed as an
+	// `array_view` for bulk algorithms.
+	template<typename T, size_t ChunkBits = 16>
+	struct segmented_array
+	{
+		typedef segmented_iterator<T, ChunkBits> iterator;
+		typedef segmented_iterator<T, ChunkBits, const T&> const_iterator;
+		typedef T value_type;
+		typedef size_t size_type;
+
+		static const size_t chunk_size = (size_t)1 << ChunkBits;
+		static const size_t chunk_mask = chunk_size - 1;
+
+		T** _chunks;
+		size_t _chunk_count;
+		size_t _chunk_capacity;
+		size_t _size;
+
+		segmented_array() : _chunks(nullptr), _chunk_count(0), _chunk_capacity(0), _size(0) { }
+		segmented_array(segmented_array&& other) : _chunks(other._chunks), _chunk_count(other._chunk_count), _chunk_capacity(other._chunk_capacity), _size(other._size) { other.forget(); }
+		segmented_array(const segmented_array&) = delete;
+		segmented_array& operator=(segmented_array&& other) { if (this != &other) { release(); _chunks = other._chunks; _chunk_count = other._chunk_count; _chunk_capacity = other._chunk_capacity; _size = other._size; other.forget(); } return *this; }
+		segmented_array& operator=(const segmented_array&) = delete;
+		~segmented_array() { release(); }
+
+		iterator begin() { return iterator(_chunks, 0); }
+		iterator end() { return iterator(_chunks, _size); }
+		const_iterator begin() const { return const_iterator(_chunks, 0); }
+		const_iterator end() const { return const_iterator(_chunks, _size); }
+		value_type& operator[](size_t n) { return _chunks[n >> ChunkBits][n & chunk_mask]; }
+		const value_type& operator[](size_t n) const { return _chunks[n >> ChunkBits][n & chunk_mask]; }
+		size_type size() const { return _size; }
+		bool empty() const { return size() == 0; }
+
+		// The number of chunks holding items
+		size_t chunk_count() const { return (_size + chunk_mask) >> ChunkBits; }
+		array_view<T> chunk(size_t c) { return array_view<T>(_chunks[c], chunk_items(c)); }
+		const_array_view<T> chunk(size_t c) const { return const_array_view<T>(_chunks[c], chunk_items(c)); }
+
+		void push_back(const T& value)
+		{
+			if ((_size & chunk_mask) == 0 && (_size >> ChunkBits) == _chunk_count) add_chunk();
+			_chunks[_size >> ChunkBits][_size & chunk_mask] = value;
+			++_size;
+		}
+
+		void append(const T* values, size_t count)
+		{
+			while (count > 0) {
+				if ((_size >> ChunkBits) == _chunk_count) add_chunk();
+				T* dest = _chunks[_size >> ChunkBits] + (_size & chunk_mask);
+				size_t n = chunk_size - (_size & chunk_mask);
+				if (n > count) n = count;
+				for (size_t i = 0; i < n; ++i) dest[i] = values[i];
+				values += n;
+				count -= n;
+				_size += n;
+			}
+		}
+
+		// Allocates chunks for at least `capacity` items up front
+		void reserve(size_t capacity)
+		{
+			while (_chunk_count * chunk_size < capacity) add_chunk();
+		}
+
+		void pop_back() { --_size; }
+
+		// Removes all items but keeps the chunks for reuse
+		void clear() { _size = 0; }
+
+	private:
+		size_t chunk_items(size_t c) const { return c + 1 < chunk_count() ? chunk_size : _size - c * chunk_size; }
+
+		void add_chunk()
+		{
+			// Only the table of chunk pointers is ever reallocated, never the items
+			if (_chunk_count == _chunk_capacity) {
+				const size_t capacity = _chunk_capacity ? _chunk_capacity * 2 : 16;
+				T** chunks = new T*[capacity];
+				for (size_t i = 0; i < _chunk_count; ++i) chunks[i] = _chunks[i];
+				delete[] _chunks;
+				_chunks = chunks;
+				_chunk_capacity = capacity;
+			}
+			_chunks[_chunk_count++] = new T[chunk_size];
+		}
+
+		void release()
+		{
+			for (size_t i = 0; i < _chunk_count; ++i) delete[] _chunks[i];
+			delete[] _chunks;
+		}
+
+		void forget() { _chunks = nullptr; _chunk_count = 0; _chunk_capacity = 0; _size = 0; }
+	};
+
+	// The operations of a type erased array, one set per wrapped array type
+	template<typename T>
+	struct any_array_ops
+	{
+		T (*at)(const void* source, size_t n);
+		void (*read)(const void* source, size_t first, size_t count, T* out);
+		const T* (*data)(const void* source);
+	};
+
+	// Finds the memory of arrays whose const iterator is a pointer, for the contiguous fast path
+	template<typename IterT, typename T>
+	struct contiguous_data { static const bool value = false; static const T* get(IterT) { return nullptr; } };
+
+	template<typename T>
+	struct contiguous_data<const T*, T> { static const bool value = true; static const T* get(const T* p) { return p; } };
+
+	template<typename T>
+	struct contiguous_data<T*, T> { static const bool value = true; static const T* get(T* p) { return p; } };
+
+	// Implements the operations for a specific array type
+	template<typename ArrayT, typename T>
+	struct any_array_impl
+	{
+		static const ArrayT& source(const void* p) { return *(const ArrayT*)p; }
+		static T at(const void* p, size_t n) { return source(p)[n]; }
+		static void read(const void* p, size_t first, size_t count, T* out) { read(source(p), first, count, out, bool_constant<has_batch_read<ArrayT, T>::value>()); }
+		static void read(const ArrayT& a, size_t first, size_t count, T* out, bool_constant<true>) { a.read(first, count, out); }
+		static void read(const ArrayT& a, size_t first, size_t count, T* out, bool_constant<false>)
+		{
+			const T* p = data(&a);
+			if (p) for (size_t i = 0; i < count; ++i) out[i] = p[first + i];
+			else for (size_t i = 0; i < count; ++i) out[i] = a[first + i];
+		}
+		static const T* data(const void* p) { return contiguous_data<decltype(source(p).begin()), T>::get(source(p).begin()); }
+
+		static const any_array_ops<T>* ops()
+		{
+			static const any_array_ops<T> r = { &at, &read, &data };
+			return &r;
+		}
+	};
+
+	// Implements the operations for contiguous memory, where the source is the pointer to the items rather than an array
+	template<typename T>
+	struct any_pointer_impl
+	{
+		static T at(const void* p, size_t n) { return ((const T*)p)[n]; }
+		static void read(const void* p, size_t first, size_t count, T* out) { for (size_t i = 0; i < count; ++i) out[i] = ((const T*)p)[first + i]; }
+		static const T* data(const void* p) { return (const T*)p; }
+
+		static const any_array_ops<T>* ops()
+		{
+			static const any_array_ops<T> r = { &at, &read, &data };
+			return &r;
+		}
+	};
+
+	// Reads items of a type erased array through its operations
+	template<typename T>
+	struct any_array_func
+	{
+		typedef T result_type;
+		const void* source;
+		const any_array_ops<T>* ops;
+		T operator()(size_t n) const { return ops->at(source, n); }
+		void read(size_t first, size_t count, T* out) const { ops->read(source, first, count, out); }
+	};
+
+	// A read-only view of any array type with items of type T: contiguous, strided, computed, or a container, for passing
+	// arrays across boundaries where their type cannot be a template parameter. Indexing costs an indirect call per item,
+	// so bulk access should use `data()`, which is the memory of contiguous arrays and null otherwise, or `read()`, which
+	// costs one indirect call per range and uses the batch `read` of computed arrays. `for_each_block` combines both.
+	// Like the other views it does not own the items, which must outlive it. Contiguous arrays are referenced by their
+	// memory, like `const_array_view`, and other arrays by their address, so wrapping a temporary is not allowed.
+	template<typename T>
+	struct any_const_array_view : public func_array<any_array_func<T>>
+	{
+		typedef func_array<any_array_func<T>> BaseT;
+
+		any_const_array_view() : BaseT(any_array_func<T>{ nullptr, nullptr }, 0) { }
+
+		template<typename ArrayT>
+		any_const_array_view(const ArrayT& source) : BaseT(erase(source, bool_constant<contiguous_data<decltype(source.begin()), T>::value>()), source.size()) { }
+
+		template<typename ArrayT>
+		any_const_array_view(const ArrayT&&) = delete;
+
+		// The items, if they are contiguous in memory, or null
+		const T* data() const { return BaseT::empty() ? nullptr : BaseT::func().ops->data(BaseT::func().source); }
+		bool is_contiguous() const { return data() != nullptr; }
+
+		// Calls f(items, first, count) for consecutive ranges of at most `BlockN` items, where `items` points at the
+		// contiguous memory of the range, or at a buffer it was read into
+		template<size_t BlockN = 256, typename F>
+		void for_each_block(F f) const
+		{
+			const size_t n = BaseT::size();
+			if (const T* p = data()) {
+				for (size_t first = 0; first < n; first += BlockN) f(p + first, first, n - first < BlockN ? n - first : BlockN);
+				return;
+			}
+			T buffer[BlockN];
+			for (size_t first = 0; first < n; first += BlockN) {
+				const size_t count = n - first < BlockN ? n - first : BlockN;
+				BaseT::read(first, count, buffer);
+				f((const T*)buffer, first, count);
+			}
+		}
+
+	private:
+		template<typename ArrayT>
+		static any_array_func<T> erase(const ArrayT& source, bool_constant<true>)
+		{
+			return any_array_func<T>{ contiguous_data<decltype(source.begin()), T>::get(source.begin()), any_pointer_impl<T>::ops() };
+		}
+
+		template<typename ArrayT>
+		static any_array_func<T> erase(const ArrayT& source, bool_constant<false>)
+		{
+			return any_array_func<T>{ &source, any_array_impl<ArrayT, T>::ops() };
+		}
+	};
+}
@@ -0,0 +1,894 @@
+/*
+	Ara 3d Array Library - Concurrency
+	Copyright 2018, Ara 3D, Inc.
+	Usage licensed under terms of MIT Licenese
+*/
+#pragma once
+
+#include "array.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace ara3d
+{
+	// The number of worker threads used by the parallel algorithms
+	inline size_t concurrency()
+	{
+		size_t n = std::thread::hardware_concurrency();
+		return n == 0 ? 1 : n;
+	}
+
+	namespace detail
+	{
+		// True on a thread that is running a parallel loop, so loops nested inside it run inline instead of oversubscribing
+		inline bool& in_parallel_loop()
+		{
+			static thread_local bool r = false;
+			return r;
+		}
+
+		// The threads that run parallel loops, started on first use and kept until the program exits. The calling thread
+		// takes part in each job, so there are `concurrency() - 1` of them. One job runs at a time.
+		struct worker_pool
+		{
+			std::mutex _mutex;
+			std::condition_variable _wake, _done;
+			std::mutex _busy;
+			void (*_run)(void* context);
+			void* _context;
+			size_t _generation, _running;
+			bool _stop;
+			array<std::thread> _threads;
+
+			worker_pool(size_t threads) : _run(nullptr), _context(nullptr), _generation(0), _running(0), _stop(false), _threads(threads)
+			{
+				for (size_t i = 0; i < threads; ++i) _threads[i] = std::thread([this]() { work(); });
+			}
+
+			~worker_pool()
+			{
+				{ std::lock_guard<std::mutex> lock(_mutex); _stop = true; }
+				_wake.notify_all();
+				for (size_t i = 0; i < _threads.size(); ++i) _threads[i].join();
+			}
+
+			// Runs `run(context)` on every thread of the pool and on the calling thread, and returns when all are done.
+			// Returns false without running anything if another thread is using the pool.
+			bool try_run(void (*run)(void* context), void* context)
+			{
+				std::unique_lock<std::mutex> busy(_busy, std::try_to_lock);
+				if (!busy.owns_lock()) return false;
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+					_run = run;
+					_context = context;
+					_running = _threads.size();
+					++_generation;
+				}
+				_wake.notify_all();
+				run(context);
+				std::unique_lock<std::mutex> lock(_mutex);
+				_done.wait(lock, [this]() { return _running == 0; });
+				return true;
+			}
+
+		private:
+			void work()
+			{
+				in_parallel_loop() = true;
+				size_t seen = 0;
+				for (;;) {
+					std::unique_lock<std::mutex> lock(_mutex);
+					_wake.wait(lock, [&]() { return _stop || _generation != seen; });
+					if (_stop) return;
+					seen = _generation;
+					void (*run)(void*) = _run;
+					void* context = _context;
+					lock.unlock();
+					run(context);
+					lock.lock();
+					if (--_running == 0) _done.notify_one();
+				}
+			}
+		};
+
+		inline worker_pool& workers()
+		{
+			static worker_pool pool(concurrency() - 1);
+			return pool;
+		}
+
+		template<typename F>
+		struct block_loop
+		{
+			F& f;
+			size_t n, grain, blocks;
+			std::atomic<size_t> next;
+
+			block_loop(F& f, size_t n, size_t grain) : f(f), n(n), grain(grain), blocks((n + grain - 1) / grain), next(0) { }
+
+			static void run(void* context)
+			{
+				block_loop& loop = *(block_loop*)context;
+				for (size_t b = loop.next.fetch_add(1); b < loop.blocks; b = loop.next.fetch_add(1)) {
+					const size_t first = b * loop.grain;
+					loop.f(first, loop.n - first < loop.grain ? loop.n : first + loop.grain);
+				}
+			}
+		};
+	}
+
+	// Calls f(first, last) on disjoint blocks of [0, n) of at most `grain` items, handed out dynamically to the threads of
+	// a pool that is reused across calls. Loops nested in another parallel loop, and loops started while another thread
+	// is using the pool, run inline on the calling thread, since the cores are already busy.
+	template<typename F>
+	void parallel_for_blocks(size_t n, F f, size_t grain = 4096)
+	{
+		if (n == 0) return;
+		if (grain == 0) grain = 1;
+		if (n <= grain || concurrency() <= 1 || detail::in_parallel_loop()) { f(size_t(0), n); return; }
+		detail::block_loop<F> loop(f, n, grain);
+		detail::in_parallel_loop() = true;
+		const bool pooled = detail::workers().try_run(detail::block_loop<F>::run, &loop);
+		detail::in_parallel_loop() = false;
+		if (!pooled) f(size_t(0), n);
+	}
+
+	// Calls f(i) for each i in [0, n) from multiple threads.
+	template<typename F>
+	void parallel_for(size_t n, F f, size_t grain = 4096)
+	{
+		parallel_for_blocks(n, [&](size_t first, size_t last) { for (size_t i = first; i < last; ++i) f(i); }, grain);
+	}
+
+	// Splits [0, n) into `parts` contiguous ranges and calls f(part, first, last) for each one concurrently.
+	// Used by algorithms that keep private per-part state (e.g. partial results) and merge it afterwards.
+	template<typename F>
+	void parallel_partition(size_t n, size_t parts, F f)
+	{
+		if (parts == 0) parts = 1;
+		parallel_for_blocks(parts, [&](size_t first, size_t last) {
+			for (size_t p = first; p < last; ++p) f(p, n * p / parts, n * (p + 1) / parts);
+		}, 1);
+	}
+
+	// A reference counted, copy-on-write array. Copies share the same elements and only hand out read-only access,
+	// until `mutable_view()` is called on a copy that is shared, which first gives it a private copy of the elements. 
+	// The reference count and the elements are kept in a single allocation, so there is one indirection to the data.
+	// Separate `shared_array` objects may be used from different threads, but a single object may not be modified concurrently.
+	template<typename T, typename BaseT = const_array_base<T, const T*>>
+	struct shared_array : public BaseT
+	{
+		struct header
+		{
+			std::atomic<size_t> _refs;
+		};
+
+		static const size_t header_size = (sizeof(header) + alignof(T) - 1) / alignof(T) * alignof(T);
+
+		shared_array(size_t size = 0) : BaseT(allocate(size), size) { for (size_t i = 0; i < size; ++i) new (data() + i) T; }
+		shared_array(const_array_view<T> values) : BaseT(allocate(values.size()), values.size()) { for (size_t i = 0; i < values.size(); ++i) new (data() + i) T(values[i]); }
+		shared_array(const shared_array& other) : BaseT(other._iter, other._size) { if (get_header()) get_header()->_refs.fetch_add(1, std::memory_order_relaxed); }
+		shared_array(shared_array&& other) : BaseT(other._iter, other._size) { other._iter = nullptr; other._size = 0; }
+		shared_array& operator=(const shared_array& other) { shared_array tmp(other); swap(tmp); return *this; }
+		shared_array& operator=(shared_array&& other) { shared_array tmp(static_cast<shared_array&&>(other)); swap(tmp); return *this; }
+		~shared_array() { release(); }
+
+		// Read-only access never copies
+		const_array_view<T> view() const { return const_array_view<T>(BaseT::_iter, BaseT::_size); }
+		size_t use_count() const { return get_header() ? get_header()->_refs.load(std::memory_order_acquire) : 0; }
+		bool unique() const { return use_count() <= 1; }
+
+		// Returns a mutable view of the elements, copying them first if they are shared with another array
+		array_view<T> mutable_view()
+		{
+			if (!unique()) {
+				shared_array copy(view());
+				swap(copy);
+			}
+			return array_view<T>(data(), BaseT::_size);
+		}
+
+		void swap(shared_array& other)
+		{
+			const T* iter = BaseT::_iter; BaseT::_iter = other._iter; other._iter = iter;
+			const size_t size = BaseT::_size; BaseT::_size = other._size; other._size = size;
+		}
+
+	private:
+		T* data() const { return const_cast<T*>(BaseT::_iter); }
+		header* get_header() const { return BaseT::_iter ? (header*)((char*)data() - header_size) : nullptr; }
+
+		static const T* allocate(size_t size)
+		{
+			if (size == 0) return nullptr;
+			char* block = (char*)::operator new(header_size + sizeof(T) * size);
+			new (block) header();
+			((header*)block)->_refs.store(1, std::memory_order_relaxed);
+			return (T*)(block + header_size);
+		}
+
+		void release()
+		{
+			header* h = get_header();
+			if (h && h->_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				for (size_t i = 0; i < BaseT::_size; ++i) data()[i].~T();
+				h->~header();
+				::operator delete((void*)h);
+			}
+			BaseT::_iter = nullptr;
+			BaseT::_size = 0;
+		}
+	};
+
+	namespace detail
+	{
+#if defined(__cpp_lib_atomic_ref)
+		template<typename T>
+		std::atomic_ref<T> atomic_at(T& value) { return std::atomic_ref<T>(value); }
+#else
+		// Before C++20 there is no atomic_ref, but a lock-free std::atomic<T> has the same representation as T on all supported compilers
+		template<typename T>
+		std::atomic<T>& atomic_at(T& value) { return reinterpret_cast<std::atomic<T>&>(value); }
+#endif
+
+		template<typename T>
+		T atomic_fetch_add(T& value, T arg, std::memory_order order, std::true_type) { return atomic_at(value).fetch_add(arg, order); }
+
+		// Floating point addition has no hardware instruction, so it is a compare-exchange loop
+		template<typename T>
+		T atomic_fetch_add(T& value, T arg, std::memory_order order, std::false_type)
+		{
+			T expected = atomic_at(value).load(std::memory_order_relaxed);
+			while (!atomic_at(value).compare_exchange_weak(expected, expected + arg, order, std::memory_order_relaxed)) { }
+			return expected;
+		}
+
+		// Replaces the value when `better(arg, current)` holds, and returns the previous value
+		template<typename T, typename BetterF>
+		T atomic_fetch_update(T& value, T arg, std::memory_order order, BetterF better)
+		{
+			T expected = atomic_at(value).load(std::memory_order_relaxed);
+			while (better(arg, expected) && !atomic_at(value).compare_exchange_weak(expected, arg, order, std::memory_order_relaxed)) { }
+			return expected;
+		}
+	}
+
+	// A view of existing memory (e.g. an `array` or `array_view`) whose items are accessed with atomic operations, with
+	// the semantics of `std::atomic_ref`, so parallel loops can accumulate into a plain array without allocating an
+	// array of `std::atomic<T>`. Operations are relaxed by default; pass acquire/release orders where items publish data.
+	// Items must be suitably aligned for atomic access, and should not be accessed non-atomically while in use.
+	template<typename T>
+	struct atomic_array_view
+	{
+		static_assert(sizeof(std::atomic<T>) == sizeof(T), "atomic_array_view needs items that can be accessed atomically in place");
+
+		typedef T value_type;
+		typedef size_t size_type;
+
+		T* _data;
+		size_t _size;
+
+		atomic_array_view(T* data = nullptr, size_t size = 0) : _data(data), _size(size) { }
+		atomic_array_view(array_view<T> view) : _data(view.begin()), _size(view.size()) { }
+
+		size_type size() const { return _size; }
+		bool empty() const { return size() == 0; }
+		array_view<T> view() const { return array_view<T>(_data, _size); }
+
+		T load(size_t n, std::memory_order order = std::memory_order_relaxed) const { return detail::atomic_at(_data[n]).load(order); }
+		void store(size_t n, T value, std::memory_order order = std::memory_order_relaxed) const { detail::atomic_at(_data[n]).store(value, order); }
+		T exchange(size_t n, T value, std::memory_order order = std::memory_order_relaxed) const { return detail::atomic_at(_data[n]).exchange(value, order); }
+		bool compare_exchange(size_t n, T& expected, T desired, std::memory_order order = std::memory_order_relaxed) const { return detail::atomic_at(_data[n]).compare_exchange_strong(expected, desired, order, std::memory_order_relaxed); }
+
+		// The fetch operations return the previous value. Floating point types are supported through compare-exchange loops.
+		T fetch_add(size_t n, T value, std::memory_order order = std::memory_order_relaxed) const { return detail::atomic_fetch_add(_data[n], value, order, std::is_integral<T>()); }
+		T fetch_sub(size_t n, T value, std::memory_order order = std::memory_order_relaxed) const { return detail::atomic_fetch_add(_data[n], (T)(T() - value), order, std::is_integral<T>()); }
+		T fetch_min(size_t n, T value, std::memory_order order = std::memory_order_relaxed) const { return detail::atomic_fetch_update(_data[n], value, order, less()); }
+		T fetch_max(size_t n, T value, std::memory_order order = std::memory_order_relaxed) const { return detail::atomic_fetch_update(_data[n], value, order, greater()); }
+
+	private:
+		struct less { bool operator()(const T& a, const T& b) const { return a < b; } };
+		struct greater { bool operator()(const T& a, const T& b) const { return b < a; } };
+	};
+
+	// A range of items that is stored in up to two contiguous blocks of memory, such as a range that wraps around the end
+	// of a ring buffer. Bulk operations can work on each block directly.
+	template<typename T>
+	struct split_array_view
+	{
+		array_view<T> first;
+		array_view<T> second;
+
+		size_t size() const { return first.size() + second.size(); }
+		bool empty() const { return size() == 0; }
+		T& operator[](size_t n) { return n < first.size() ? first[n] : second[n - first.size()]; }
+		const T& operator[](size_t n) const { return n < first.size() ? first[n] : second[n - first.size()]; }
+	};
+
+	// An append-only array that many threads can fill at once without locks. Each writer reserves a range of items with a
+	// single atomic add and writes straight into the reserved memory, so there are no per-thread buffers to merge afterwards.
+	// Storage is a table of chunks of 2^ChunkBits items, so items never move; chunks are allocated by the first thread
+	// that needs them. When the writers are done, `finish()` hands the chunks to a `segmented_array` without copying.
+	// Items that would land past `max_size()` are not stored: `reserve` returns a shorter range, `push_back` returns
+	// SIZE_MAX, and `append` copies only the items that fit.
+	template<typename T, size_t ChunkBits = 16>
+	struct concurrent_append_array
+	{
+		static const size_t chunk_size = (size_t)1 << ChunkBits;
+		static const size_t chunk_mask = chunk_size - 1;
+
+		// A reserved range of items. The range is at most one chunk long, so it is split over at most two contiguous views.
+		struct range : public split_array_view<T>
+		{
+			size_t index;
+		};
+
+		array<std::atomic<T*>> _chunks;
+		std::atomic<size_t> _size;
+
+		// Creates an empty array that can hold up to `max_size` items. Only the table of chunk pointers is allocated up front.
+		concurrent_append_array(size_t max_size = (size_t)1 << 32) : _chunks((max_size + chunk_mask) >> ChunkBits), _size(0)
+		{
+			for (size_t c = 0; c < _chunks.size(); ++c) _chunks[c].store(nullptr, std::memory_order_relaxed);
+		}
+		concurrent_append_array(const concurrent_append_array&) = delete;
+		concurrent_append_array& operator=(const concurrent_append_array&) = delete;
+		~concurrent_append_array() { for (size_t c = 0; c < _chunks.size(); ++c) delete[] _chunks[c].load(std::memory_order_relaxed); }
+
+		// The number of items reserved so far. Items are only safe to read once the threads that reserved them are done writing.
+		size_t size() const { const size_t n = _size.load(std::memory_order_acquire); return n < max_size() ? n : max_size(); }
+		bool empty() const { return size() == 0; }
+		size_t max_size() const { return _chunks.size() << ChunkBits; }
+		size_t chunk_count() const { return (size() + chunk_mask) >> ChunkBits; }
+		T& operator[](size_t n) const { return _chunks[n >> ChunkBits].load(std::memory_order_acquire)[n & chunk_mask]; }
+
+		const_array_view<T> chunk(size_t c) const
+		{
+			const size_t n = size() - c * chunk_size;
+			return const_array_view<T>(_chunks[c].load(std::memory_order_acquire), n < chunk_size ? n : chunk_size);
+		}
+
+		// Reserves up to `count` consecutive items for the calling thread to write. At most one chunk's worth is reserved,
+		// and none past `max_size()`, so the returned range is shorter than `count` when either limit is reached.
+		range reserve(size_t count)
+		{
+			range r;
+			if (count > chunk_size) count = chunk_size;
+			r.index = _size.fetch_add(count, std::memory_order_relaxed);
+			const size_t available = r.index < max_size() ? max_size() - r.index : 0;
+			if (count > available) count = available;
+			const size_t offset = r.index & chunk_mask;
+			const size_t n = chunk_size - offset < count ? chunk_size - offset : count;
+			r.first = array_view<T>(count ? chunk_for(r.index) + offset : nullptr, n);
+			r.second = array_view<T>(count > n ? chunk_for(r.index + n) : nullptr, count - n);
+			return r;
+		}
+
+		// Appends one item and returns its index, or SIZE_MAX if the array is full
+		size_t push_back(const T& value)
+		{
+			const size_t index = _size.fetch_add(1, std::memory_order_relaxed);
+			if (index >= max_size()) return SIZE_MAX;
+			chunk_for(index)[index & chunk_mask] = value;
+			return index;
+		}
+
+		// Appends any number of items as one consecutive range, and returns the index of the first. Only the items below
+		// `max_size()` are stored, so the append was complete if the index plus `count` is at most `max_size()`.
+		size_t append(const T* values, size_t count)
+		{
+			const size_t index = _size.fetch_add(count, std::memory_order_relaxed);
+			if (index >= max_size()) return index;
+			if (count > max_size() - index) count = max_size() - index;
+			for (size_t i = 0; i < count; ) {
+				const size_t offset = (index + i) & chunk_mask;
+				T* dest = chunk_for(index + i) + offset;
+				const size_t n = chunk_size - offset < count - i ? chunk_size - offset : count - i;
+				for (size_t j = 0; j < n; ++j) dest[j] = values[i + j];
+				i += n;
+			}
+			return index;
+		}
+
+		// Moves the items into a segmented array and leaves this empty. Must not be called while other threads are writing.
+		segmented_array<T, ChunkBits> finish()
+		{
+			segmented_array<T, ChunkBits> r;
+			const size_t n = size();
+			const size_t chunks = (n + chunk_mask) >> ChunkBits;
+			r._chunks = new T*[chunks ? chunks : 1];
+			r._chunk_capacity = chunks ? chunks : 1;
+			for (size_t c = 0; c < chunks; ++c) r._chunks[c] = chunk_for(c << ChunkBits);
+			for (size_t c = 0; c < _chunks.size(); ++c) {
+				T* p = _chunks[c].exchange(nullptr, std::memory_order_relaxed);
+				if (c >= chunks) delete[] p;
+			}
+			r._chunk_count = chunks;
+			r._size = n;
+			_size.store(0, std::memory_order_release);
+			return r;
+		}
+
+	private:
+		// Returns the chunk holding item `n`, allocating it if this is the first thread to need it
+		T* chunk_for(size_t n)
+		{
+			std::atomic<T*>& slot = _chunks[n >> ChunkBits];
+			T* chunk = slot.load(std::memory_order_acquire);
+			if (chunk) return chunk;
+			T* fresh = new T[chunk_size];
+			if (slot.compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) return fresh;
+			delete[] fresh;
+			return chunk;
+		}
+	};
+
+	// Iterator over a `cached_array`, which computes chunks as they are first reached
+	template<typename T, typename CachedT>
+	struct cached_array_iterator
+	{
+		typedef T value_type;
+
+		const CachedT* _array;
+		size_t _i;
+
+		cached_array_iterator(const CachedT* array = nullptr, size_t i = 0) : _array(array), _i(i) { }
+		const value_type& operator*() const { return _array->at(_i); }
+		bool operator==(const cached_array_iterator iter) const { return _i == iter._i; }
+		bool operator!=(const cached_array_iterator iter) const { return _i != iter._i; }
+		cached_array_iterator& operator++() { return this->operator+=(1); }
+		cached_array_iterator operator++(int) { cached_array_iterator r = *this; ++*this; return r; }
+		cached_array_iterator& operator+=(size_t n) { _i += n; return *this; }
+		cached_array_iterator operator+(size_t n) const { return cached_array_iterator(_array, _i + n); }
+		ptrdiff_t operator-(const cached_array_iterator& iter) const { return _i - iter._i; }
+		const value_type& operator[](size_t n) const { return _array->at(_i + n); }
+	};
+
+	// A computed array that remembers what it computes. Items are computed a chunk of 2^ChunkBits at a time, the first
+	// time any item of the chunk is read, using the function's batch `read` when it has one; later reads return the
+	// stored items. A bitset of ready chunks makes the check one load, and a bitset of claimed chunks ensures that each
+	// chunk is computed once even when many threads reach it together (the others wait for it). Only chunks that are
+	// read are allocated, so reading a small part of a huge array costs memory for that part only.
+	// References to items stay valid for the lifetime of the array, so it can be neither copied nor moved.
+	template<typename F, size_t ChunkBits = 12, typename ValueT = typename func_array_iterator<F>::value_type>
+	struct cached_array : public const_array_base<ValueT, cached_array_iterator<ValueT, cached_array<F, ChunkBits, ValueT>>>
+	{
+		typedef cached_array_iterator<ValueT, cached_array> IterT;
+		typedef const_array_base<ValueT, IterT> BaseT;
+		static const size_t chunk_size = (size_t)1 << ChunkBits;
+		static const size_t chunk_mask = chunk_size - 1;
+
+		func_array<F, ValueT> _source;
+		mutable array<ValueT*> _chunks;
+		mutable array<std::atomic<uint64_t>> _ready;
+		mutable array<std::atomic<uint64_t>> _claimed;
+
+		cached_array(F func, size_t size)
+			: BaseT(IterT(this), size), _source(func, size), _chunks((size + chunk_mask) >> ChunkBits),
+			_ready((_chunks.size() + 63) / 64), _claimed(_ready.size())
+		{
+			for (size_t c = 0; c < _chunks.size(); ++c) _chunks[c] = nullptr;
+			for (size_t w = 0; w < _ready.size(); ++w) { _ready[w].store(0, std::memory_order_relaxed); _claimed[w].store(0, std::memory_order_relaxed); }
+		}
+		cached_array(const cached_array&) = delete;
+		cached_array& operator=(const cached_array&) = delete;
+		~cached_array() { for (size_t c = 0; c < _chunks.size(); ++c) delete[] _chunks[c]; }
+
+		size_t chunk_count() const { return _chunks.size(); }
+
+		bool is_ready(size_t c) const { return (_ready[c >> 6].load(std::memory_order_acquire) >> (c & 63)) & 1; }
+
+		// Returns item `n`, computing its chunk first if no thread has yet
+		const ValueT& at(size_t n) const { return chunk(n >> ChunkBits)[n & chunk_mask]; }
+
+		// Returns the items of chunk `c`, computing them first if no thread has yet
+		const_array_view<ValueT> chunk(size_t c) const
+		{
+			const size_t first = c << ChunkBits;
+			const size_t n = BaseT::size() - first < chunk_size ? BaseT::size() - first : chunk_size;
+			if (!is_ready(c)) fill(c);
+			return const_array_view<ValueT>(_chunks[c], n);
+		}
+
+		// Computes the chunks that hold the items [first, first + count) ahead of time, in parallel. Items past the end are ignored.
+		void prefetch(size_t first, size_t count) const
+		{
+			if (first >= BaseT::size()) return;
+			if (count > BaseT::size() - first) count = BaseT::size() - first;
+			if (count == 0) return;
+			const size_t c0 = first >> ChunkBits, c1 = ((first + count - 1) >> ChunkBits) + 1;
+			parallel_for(c1 - c0, [&](size_t c) { if (!is_ready(c0 + c)) fill(c0 + c); }, 1);
+		}
+
+	private:
+		void fill(size_t c) const
+		{
+			const uint64_t bit = (uint64_t)1 << (c & 63);
+			if (_claimed[c >> 6].fetch_or(bit, std::memory_order_acq_rel) & bit) {
+				while (!is_ready(c)) std::this_thread::yield();
+				return;
+			}
+			const size_t first = c << ChunkBits;
+			const size_t n = BaseT::size() - first < chunk_size ? BaseT::size() - first : chunk_size;
+			ValueT* items = new ValueT[chunk_size];
+			_source.read(first, n, items);
+			_chunks[c] = items;
+			_ready[c >> 6].fetch_or(bit, std::memory_order_release);
+		}
+	};
+
+	// The assumed size of a cache line, used to keep data written by different threads apart
+	static const size_t cache_line_size = 64;
+
+	// A batch of ring buffer slots claimed by `begin_push` or `begin_pop`, which must be handed back to `end_push` or `end_pop`
+	template<typename T>
+	struct ring_batch : public split_array_view<T>
+	{
+		size_t position;
+	};
+
+	namespace detail
+	{
+		inline size_t ring_capacity(size_t capacity)
+		{
+			size_t n = 1;
+			while (n < capacity) n <<= 1;
+			return n;
+		}
+
+		template<typename T>
+		ring_batch<T> make_ring_batch(array<T>& items, size_t position, size_t count)
+		{
+			ring_batch<T> r;
+			const size_t index = position & (items.size() - 1);
+			const size_t n = items.size() - index < count ? items.size() - index : count;
+			r.position = position;
+			r.first = array_view<T>(items.begin() + index, n);
+			r.second = array_view<T>(items.begin(), count - n);
+			return r;
+		}
+
+		template<typename RingT, typename T>
+		size_t ring_push(RingT& ring, const T* values, size_t count)
+		{
+			ring_batch<T> batch = ring.begin_push(count);
+			for (size_t i = 0; i < batch.size(); ++i) batch[i] = values[i];
+			ring.end_push(batch);
+			return batch.size();
+		}
+
+		template<typename RingT, typename T>
+		size_t ring_pop(RingT& ring, T* values, size_t count)
+		{
+			ring_batch<T> batch = ring.begin_pop(count);
+			for (size_t i = 0; i < batch.size(); ++i) values[i] = static_cast<T&&>(batch[i]);
+			ring.end_pop(batch);
+			return batch.size();
+		}
+	}
+
+	// A bounded lock-free queue for exactly one producer thread and one consumer thread. Items live in an array whose size
+	// is a power of two, and the producer and consumer indices are on separate cache lines. `begin_push` and `begin_pop`
+	// give direct access to up to `count` slots as at most two contiguous views, so bulk transfers need no extra copy.
+	template<typename T>
+	struct spsc_ring
+	{
+		array<T> _items;
+		size_t _mask;
+		char _pad0[cache_line_size];
+		// Written by the producer
+		std::atomic<size_t> _tail;
+		size_t _cached_head;
+		char _pad1[cache_line_size];
+		// Written by the consumer
+		std::atomic<size_t> _head;
+		size_t _cached_tail;
+		char _pad2[cache_line_size];
+
+		// Creates a queue holding at least `capacity` items, rounded up to a power of two
+		spsc_ring(size_t capacity) : _items(detail::ring_capacity(capacity)), _mask(_items.size() - 1), _tail(0), _cached_head(0), _head(0), _cached_tail(0) { }
+		spsc_ring(const spsc_ring&) = delete;
+		spsc_ring& operator=(const spsc_ring&) = delete;
+
+		size_t capacity() const { return _items.size(); }
+		// An estimate when called while the other thread is active
+		size_t size() const { return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire); }
+
+		// Producer: claims up to `count` free slots to write into
+		ring_batch<T> begin_push(size_t count)
+		{
+			const size_t tail = _tail.load(std::memory_order_relaxed);
+			if (capacity() - (tail - _cached_head) < count) _cached_head = _head.load(std::memory_order_acquire);
+			const size_t free = capacity() - (tail - _cached_head);
+			return detail::make_ring_batch(_items, tail, free < count ? free : count);
+		}
+
+		// Producer: publishes the slots of a batch to the consumer
+		void end_push(const ring_batch<T>& batch) { _tail.store(batch.position + batch.size(), std::memory_order_release); }
+
+		// Consumer: claims up to `count` items to read
+		ring_batch<T> begin_pop(size_t count)
+		{
+			const size_t head = _head.load(std::memory_order_relaxed);
+			if (_cached_tail - head < count) _cached_tail = _tail.load(std::memory_order_acquire);
+			const size_t ready = _cached_tail - head;
+			return detail::make_ring_batch(_items, head, ready < count ? ready : count);
+		}
+
+		// Consumer: returns the slots of a batch to the producer
+		void end_pop(const ring_batch<T>& batch) { _head.store(batch.position + batch.size(), std::memory_order_release); }
+
+		bool push(const T& value) { return push(&value, 1) == 1; }
+		bool pop(T& value) { return pop(&value, 1) == 1; }
+		size_t push(const T* values, size_t count) { return detail::ring_push(*this, values, count); }
+		size_t pop(T* values, size_t count) { return detail::ring_pop(*this, values, count); }
+	};
+
+	// A bounded lock-free queue for any number of producer and consumer threads (after Vyukov), with the same batch interface
+	// as `spsc_ring`. Each slot has a sequence number that says whether it is free or holds an item for a given position,
+	// so threads claim a run of consecutive slots with a single compare-exchange and then fill or drain them independently.
+	template<typename T>
+	struct mpmc_ring
+	{
+		array<T> _items;
+		array<std::atomic<size_t>> _sequence;
+		size_t _mask;
+		char _pad0[cache_line_size];
+		std::atomic<size_t> _tail;
+		char _pad1[cache_line_size];
+		std::atomic<size_t> _head;
+		char _pad2[cache_line_size];
+
+		// Creates a queue holding at least `capacity` items, rounded up to a power of two
+		mpmc_ring(size_t capacity) : _items(detail::ring_capacity(capacity)), _sequence(_items.size()), _mask(_items.size() - 1), _tail(0), _head(0)
+		{
+			for (size_t i = 0; i < _sequence.size(); ++i) _sequence[i].store(i, std::memory_order_relaxed);
+		}
+		mpmc_ring(const mpmc_ring&) = delete;
+		mpmc_ring& operator=(const mpmc_ring&) = delete;
+
+		size_t capacity() const { return _items.size(); }
+		// An estimate when called while other threads are active
+		size_t size() const { return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire); }
+
+		// Claims up to `count` consecutive free slots to write into. Returns an empty batch if the queue is full.
+		ring_batch<T> begin_push(size_t count) { return claim(_tail, count, 0); }
+
+		// Publishes the slots of a batch to consumers
+		void end_push(const ring_batch<T>& batch)
+		{
+			for (size_t i = 0; i < batch.size(); ++i) _sequence[(batch.position + i) & _mask].store(batch.position + i + 1, std::memory_order_release);
+		}
+
+		// Claims up to `count` consecutive items to read. Returns an empty batch if the queue is empty.
+		ring_batch<T> begin_pop(size_t count) { return claim(_head, count, 1); }
+
+		// Returns the slots of a batch to producers
+		void end_pop(const ring_batch<T>& batch)
+		{
+			for (size_t i = 0; i < batch.size(); ++i) _sequence[(batch.position + i) & _mask].store(batch.position + i + capacity(), std::memory_order_release);
+		}
+
+		bool push(const T& value) { return push(&value, 1) == 1; }
+		bool pop(T& value) { return pop(&value, 1) == 1; }
+		size_t push(const T* values, size_t count) { return detail::ring_push(*this, values, count); }
+		size_t pop(T* values, size_t count) { return detail::ring_pop(*this, values, count); }
+
+	private:
+		// A slot at `position` is ready to push when its sequence is `position`, and ready to pop when it is `position + 1`
+		ring_batch<T> claim(std::atomic<size_t>& cursor, size_t count, size_t ready)
+		{
+			size_t position = cursor.load(std::memory_order_relaxed);
+			for (;;) {
+				size_t n = 0;
+				while (n < count && _sequence[(position + n) & _mask].load(std::memory_order_acquire) == position + n + ready) ++n;
+				if (n == 0) {
+					const ptrdiff_t diff = (ptrdiff_t)(_sequence[position & _mask].load(std::memory_order_acquire) - (position + ready));
+					if (diff < 0 || count == 0) return detail::make_ring_batch(_items, position, 0);
+					position = cursor.load(std::memory_order_relaxed);
+					continue;
+				}
+				if (cursor.compare_exchange_weak(position, position + n, std::memory_order_relaxed)) return detail::make_ring_batch(_items, position, n);
+			}
+		}
+	};
+
+	// Replaces each value with the sum of the values that precede it, and returns the total.
+	template<typename T, typename ViewT>
+	T parallel_exclusive_scan(ViewT& values)
+	{
+		const size_t n = values.size();
+		const size_t parts = n < 65536 ? 1 : concurrency();
+		array<T> sums(parts + 1);
+		parallel_partition(n, parts, [&](size_t p, size_t first, size_t last) {
+			T sum = T();
+			for (size_t i = first; i < last; ++i) sum += values[i];
+			sums[p + 1] = sum;
+		});
+		sums[0] = T();
+		for (size_t p = 0; p < parts; ++p) sums[p + 1] += sums[p];
+		parallel_partition(n, parts, [&](size_t p, size_t first, size_t last) {
+			T sum = sums[p];
+			for (size_t i = first; i < last; ++i) { T v = values[i]; values[i] = sum; sum += v; }
+		});
+		return sums[parts];
+	}
+
+	// Computes the permutation that stably sorts `keys` in ascending order, using a parallel LSD radix sort. 
+	// Byte positions that are the same in every key are skipped, so narrow keys cost fewer passes.
+	inline array<uint32_t> sort_permutation(const_array_view<uint64_t> keys)
+	{
+		const size_t n = keys.size();
+		const size_t parts = n < 65536 ? 1 : concurrency();
+		array<uint64_t> src_keys(n), dst_keys(n);
+		array<uint32_t> src_ids(n), dst_ids(n);
+		array<uint64_t> varying(parts);
+		parallel_partition(n, parts, [&](size_t p, size_t first, size_t last) {
+			uint64_t bits = 0;
+			for (size_t i = first; i < last; ++i) { src_keys[i] = keys[i]; src_ids[i] = (uint32_t)i; bits |= keys[i] ^ keys[0]; }
+			varying[p] = bits;
+		});
+		uint64_t bits = 0;
+		for (size_t p = 0; p < parts; ++p) bits |= varying[p];
+		array<size_t> counts(parts * 256);
+		for (unsigned shift = 0; shift < 64; shift += 8)
+		{
+			if (((bits >> shift) & 0xFF) == 0) continue;
+			parallel_partition(n, parts, [&](size_t p, size_t first, size_t last) {
+				size_t* c = counts.begin() + p * 256;
+				for (size_t d = 0; d < 256; ++d) c[d] = 0;
+				for (size_t i = first; i < last; ++i) ++c[(src_keys[i] >> shift) & 0xFF];
+			});
+			size_t sum = 0;
+			for (size_t d = 0; d < 256; ++d)
+				for (size_t p = 0; p < parts; ++p) { const size_t c = counts[p * 256 + d]; counts[p * 256 + d] = sum; sum += c; }
+			parallel_partition(n, parts, [&](size_t p, size_t first, size_t last) {
+				size_t* c = counts.begin() + p * 256;
+				for (size_t i = first; i < last; ++i) {
+					const size_t j = c[(src_keys[i] >> shift) & 0xFF]++;
+					dst_keys[j] = src_keys[i];
+					dst_ids[j] = src_ids[i];
+				}
+			});
+			std::swap(src_keys, dst_keys);
+			std::swap(src_ids, dst_ids);
+		}
+		return src_ids;
+	}
+
+	namespace detail
+	{
+		// The set of columns reordered together by `reorder`, each with a copy of its original contents to gather from
+		template<typename... ViewsT>
+		struct reorder_columns
+		{
+			reorder_columns() { }
+			void gather(const uint32_t*, size_t, size_t) { }
+		};
+
+		template<typename ViewT, typename... RestT>
+		struct reorder_columns<ViewT, RestT...>
+		{
+			ViewT& _view;
+			array<typename ViewT::value_type> _source;
+			reorder_columns<RestT...> _rest;
+
+			reorder_columns(ViewT& view, RestT&... rest) : _view(view), _source(view.size()), _rest(rest...)
+			{
+				parallel_for(_source.size(), [&](size_t i) { _source[i] = _view[i]; });
+			}
+
+			void gather(const uint32_t* permutation, size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; ++i) _view[i] = _source[permutation[i]];
+				_rest.gather(permutation, first, last);
+			}
+		};
+	}
+
+	// Reorders several arrays in place so that item `i` of each becomes its former item `permutation[i]`.
+	// The arrays can be any mutable array type (e.g. the columns of a structure of arrays, or `array_mem_stride`
+	// views into interleaved data) and must be the same size as the permutation. The work is done in cache-sized
+	// blocks of the permutation, each applied to all of the arrays before moving on, in parallel.
+	template<typename... ViewsT>
+	void reorder(const_array_view<uint32_t> permutation, ViewsT&... views)
+	{
+		detail::reorder_columns<ViewsT...> columns(views...);
+		parallel_for_blocks(permutation.size(), [&](size_t first, size_t last) { columns.gather(permutation.begin(), first, last); }, 2048);
+	}
+
+	namespace detail
+	{
+		// Private per-thread counts are faster than shared atomic counts, unless there are so many bins that the copies outweigh the keys
+		inline size_t histogram_parts(size_t n, size_t bins)
+		{
+			const size_t parts = n < 65536 ? 1 : concurrency();
+			return parts == 1 || bins <= 65536 || bins * parts <= n ? parts : 0;
+		}
+
+		// Counts the keys of each part into its own row of `counts`, which has `bins` columns
+		inline void count_keys(const_array_view<uint32_t> keys, size_t bins, size_t parts, array<uint32_t>& counts)
+		{
+			counts = array<uint32_t>(parts * bins);
+			parallel_partition(keys.size(), parts, [&](size_t p, size_t first, size_t last) {
+				uint32_t* c = counts.begin() + p * bins;
+				for (size_t k = 0; k < bins; ++k) c[k] = 0;
+				for (size_t i = first; i < last; ++i) ++c[keys[i]];
+			});
+		}
+	}
+
+	// Counts how many times each value in [0, bins) occurs in `keys`. Every key must be less than `bins`.
+	// Each thread counts into a private histogram, and the histograms are summed with contiguous, vectorizable loops.
+	// With very many bins it counts into a single histogram with atomic adds instead.
+	inline array<uint32_t> histogram(const_array_view<uint32_t> keys, size_t bins)
+	{
+		array<uint32_t> r(bins);
+		const size_t parts = detail::histogram_parts(keys.size(), bins);
+		if (parts == 0) {
+			parallel_for(bins, [&](size_t k) { r[k] = 0; });
+			atomic_array_view<uint32_t> counts(r);
+			parallel_for(keys.size(), [&](size_t i) { counts.fetch_add(keys[i], 1); });
+			return r;
+		}
+		array<uint32_t> counts;
+		detail::count_keys(keys, bins, parts, counts);
+		parallel_for_blocks(bins, [&](size_t first, size_t last) {
+			for (size_t k = first; k < last; ++k) r[k] = counts[k];
+			for (size_t p = 1; p < parts; ++p) {
+				const uint32_t* c = counts.begin() + p * bins;
+				for (size_t k = first; k < last; ++k) r[k] += c[k];
+			}
+		});
+		return r;
+	}
+
+	// Groups the rows [0, keys.size()) by a small integer key in [0, bins): the rows with key `k` are written in ascending
+	// order to `rows[offsets[k]] .. rows[offsets[k + 1] - 1]`. The rows form a permutation that can be applied to other
+	// columns with `reorder`. Every key must be less than `bins`.
+	inline void counting_sort_by_key(const_array_view<uint32_t> keys, size_t bins, array<uint32_t>& offsets, array<uint32_t>& rows)
+	{
+		const size_t n = keys.size();
+		const size_t parts = detail::histogram_parts(n, bins);
+		offsets = array<uint32_t>(bins + 1);
+		rows = array<uint32_t>(n);
+		if (parts == 0) {
+			// Too many bins for private counts: count and scatter with atomics, then restore the order within each group
+			array<uint32_t> cursors = histogram(keys, bins);
+			parallel_for(bins, [&](size_t k) { offsets[k] = cursors[k]; });
+			offsets[bins] = 0;
+			parallel_exclusive_scan<uint32_t>(offsets);
+			parallel_for(bins, [&](size_t k) { cursors[k] = offsets[k]; });
+			atomic_array_view<uint32_t> next(cursors);
+			parallel_for(n, [&](size_t i) { rows[next.fetch_add(keys[i], 1)] = (uint32_t)i; });
+			parallel_for(bins, [&](size_t k) { std::sort(rows.begin() + offsets[k], rows.begin() + offsets[k + 1]); }, 1024);
+			return;
+		}
+		// Each part scatters its rows in order, starting after the rows with the same key from earlier parts, so the sort is stable
+		array<uint32_t> counts;
+		detail::count_keys(keys, bins, parts, counts);
+		parallel_for(bins, [&](size_t k) {
+			uint32_t total = 0;
+			for (size_t p = 0; p < parts; ++p) total += counts[p * bins + k];
+			offsets[k] = total;
+		});
+		offsets[bins] = 0;
+		parallel_exclusive_scan<uint32_t>(offsets);
+		parallel_for(bins, [&](size_t k) {
+			uint32_t start = offsets[k];
+			for (size_t p = 0; p < parts; ++p) { const uint32_t c = counts[p * bins + k]; counts[p * bins + k] = start; start += c; }
+		});
+		parallel_partition(n, parts, [&](size_t p, size_t first, size_t last) {
+			uint32_t* next = counts.begin() + p * bins;
+			for (size_t i = first; i < last; ++i) rows[next[keys[i]]++] = (uint32_t)i;
+		});
+	}
+}
@@ -0,0 +1,1043 @@
+/*
+	Ara 3d Array Library - Geometry
+	Copyright 2018, Ara 3D, Inc.
+	Usage licensed under terms of MIT Licenese
+*/
+#pragma once
+
+#include "array_concurrent.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// BMI2 is used when the compiler targets it. AVX2 does not imply BMI2, and MSVC defines no macro for BMI2,
+// so MSVC builds for processors that have it opt in by defining ARA3D_USE_BMI2.
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(ARA3D_USE_BMI2))
+#define ARA3D_BMI2 1
+#include <immintrin.h>
+#endif
+
+namespace ara3d
+{
+	// A minimal 3D vector, used by the geometry kernels for outputs and intermediate values
+	struct float3
+	{
+		float x, y, z;
+	};
+
+	// A minimal 4D vector, used for tangents where w holds the handedness of the bitangent
+	struct float4
+	{
+		float x, y, z, w;
+	};
+
+	// Provides component access to a point type. The default works with any type that has x, y, and z members; specialize it for others.
+	template<typename P>
+	struct point_traits
+	{
+		static float x(const P& p) { return (float)p.x; }
+		static float y(const P& p) { return (float)p.y; }
+		static float z(const P& p) { return (float)p.z; }
+		static void set(P& p, float x, float y, float z) { p.x = x; p.y = y; p.z = z; }
+	};
+
+	namespace detail
+	{
+		template<typename P>
+		void get_point(const P& p, float* out)
+		{
+			out[0] = point_traits<P>::x(p); out[1] = point_traits<P>::y(p); out[2] = point_traits<P>::z(p);
+		}
+
+		template<typename P>
+		void set_point(P& p, const float* v)
+		{
+			point_traits<P>::set(p, v[0], v[1], v[2]);
+		}
+
+		inline void cross(const float* a, const float* b, float* out)
+		{
+			out[0] = a[1] * b[2] - a[2] * b[1];
+			out[1] = a[2] * b[0] - a[0] * b[2];
+			out[2] = a[0] * b[1] - a[1] * b[0];
+		}
+
+		inline float dot(const float* a, const float* b)
+		{
+			return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+		}
+
+		// Scales a vector to unit length, leaving degenerate vectors as zero
+		inline void normalize(float* v)
+		{
+			const float length = std::sqrt(dot(v, v));
+			const float scale = length > 0 ? 1.0f / length : 0.0f;
+			v[0] *= scale; v[1] *= scale; v[2] *= scale;
+		}
+	}
+
+	// Computes the axis-aligned bounding box of an array of points in parallel. The box of an empty array is all zeros.
+	template<typename PointsT>
+	void point_bounds(const PointsT& points, float lo[3], float hi[3])
+	{
+		typedef point_traits<typename PointsT::value_type> traits;
+		const size_t n = points.size();
+		const size_t parts = n < 65536 ? 1 : concurrency();
+		array<float> bounds(parts * 6);
+		parallel_partition(n, parts, [&](size_t p, size_t first, size_t last) {
+			float* b = bounds.begin() + p * 6;
+			b[0] = b[1] = b[2] = INFINITY;
+			b[3] = b[4] = b[5] = -INFINITY;
+			for (size_t i = first; i < last; ++i) {
+				const typename PointsT::value_type& pt = points[i];
+				const float v[3] = { traits::x(pt), traits::y(pt), traits::z(pt) };
+				for (int a = 0; a < 3; ++a) { b[a] = std::min(b[a], v[a]); b[a + 3] = std::max(b[a + 3], v[a]); }
+			}
+		});
+		for (int a = 0; a < 3; ++a) { lo[a] = INFINITY; hi[a] = -INFINITY; }
+		for (size_t p = 0; p < parts; ++p)
+			for (int a = 0; a < 3; ++a) { lo[a] = std::min(lo[a], bounds[p * 6 + a]); hi[a] = std::max(hi[a], bounds[p * 6 + a + 3]); }
+		if (n == 0)
+			for (int a = 0; a < 3; ++a) lo[a] = hi[a] = 0;
+	}
+
+	// A uniform grid over a set of points, stored in compressed sparse row form: the points in cell `c` are
+	// `indices[offsets[c]] .. indices[offsets[c + 1] - 1]`, in ascending order. The points are any array type
+	// (e.g. `const_array_view`, `const_array_mem_stride`, or `func_array`) and are referenced, not copied.
+	// Queries do not allocate, and batched queries run in parallel.
+	template<typename PointsT>
+	struct spatial_grid
+	{
+		typedef typename PointsT::value_type point_type;
+		typedef point_traits<point_type> traits;
+
+		PointsT _points;
+		float _min[3];
+		float _cell_size;
+		float _inv_cell_size;
+		uint32_t _dims[3];
+		array<uint32_t> _offsets;
+		array<uint32_t> _indices;
+
+		// Builds the grid with a counting sort. A cell size of zero picks one that averages about two points per cell.
+		spatial_grid(const PointsT& points, float cell_size = 0)
+			: _points(points), _cell_size(cell_size), _inv_cell_size(0)
+		{
+			const size_t n = points.size();
+			compute_bounds(cell_size);
+			array<uint32_t> point_cells(n);
+			parallel_for(n, [&](size_t i) { point_cells[i] = cell_of(_points[i]); });
+			counting_sort_by_key(point_cells, cell_count(), _offsets, _indices);
+		}
+
+		size_t size() const { return _points.size(); }
+		size_t cell_count() const { return (size_t)_dims[0] * _dims[1] * _dims[2]; }
+		float cell_size() const { return _cell_size; }
+		const_array_view<uint32_t> cell_points(size_t c) const { return const_array_view<uint32_t>(_indices.begin() + _offsets[c], _offsets[c + 1] - _offsets[c]); }
+		const array<uint32_t>& offsets() const { return _offsets; }
+		const array<uint32_t>& indices() const { return _indices; }
+
+		uint32_t cell_coord(float v, int axis) const
+		{
+			const float f = (v - _min[axis]) * _inv_cell_size;
+			if (!(f > 0)) return 0;
+			return f >= (float)_dims[axis] ? _dims[axis] - 1 : (uint32_t)f;
+		}
+
+		template<typename P>
+		uint32_t cell_of(const P& p) const
+		{
+			typedef point_traits<P> pt;
+			return (cell_coord(pt::z(p), 2) * _dims[1] + cell_coord(pt::y(p), 1)) * _dims[0] + cell_coord(pt::x(p), 0);
+		}
+
+		// Writes the indices of points within `radius` of `center` into `out`, and returns how many were found.
+		// If the return value exceeds `out.size()` only the first `out.size()` are written.
+		template<typename P>
+		size_t query_radius(const P& center, float radius, array_view<uint32_t> out) const
+		{
+			typedef point_traits<P> pt;
+			const float c[3] = { pt::x(center), pt::y(center), pt::z(center) };
+			const float r2 = radius * radius;
+			uint32_t lo[3], hi[3];
+			for (int a = 0; a < 3; ++a) { lo[a] = cell_coord(c[a] - radius, a); hi[a] = cell_coord(c[a] + radius, a); }
+			size_t found = 0;
+			for (uint32_t z = lo[2]; z <= hi[2]; ++z)
+				for (uint32_t y = lo[1]; y <= hi[1]; ++y)
+				{
+					const size_t row = ((size_t)z * _dims[1] + y) * _dims[0];
+					for (uint32_t i = _offsets[row + lo[0]], end = _offsets[row + hi[0] + 1]; i < end; ++i)
+					{
+						const uint32_t index = _indices[i];
+						if (distance_squared(c, _points[index]) <= r2) {
+							if (found < out.size()) out[found] = index;
+							++found;
+						}
+					}
+				}
+			return found;
+		}
+
+		// Finds the `k` points nearest to `center`, writing their indices and squared distances in ascending order of distance.
+		// Both outputs must hold at least `k` items. Returns the number of points found, which is less than `k` only if the grid has fewer points.
+		template<typename P>
+		size_t query_knn(const P& center, size_t k, array_view<uint32_t> out_indices, array_view<float> out_dist2) const
+		{
+			typedef point_traits<P> pt;
+			const float c[3] = { pt::x(center), pt::y(center), pt::z(center) };
+			if (k > size()) k = size();
+			if (k == 0) return 0;
+			uint32_t* heap_ids = out_indices.begin();
+			float* heap_d2 = out_dist2.begin();
+			size_t found = 0;
+			const uint32_t cc[3] = { cell_coord(c[0], 0), cell_coord(c[1], 1), cell_coord(c[2], 2) };
+			const uint32_t max_ring = std::max(_dims[0], std::max(_dims[1], _dims[2]));
+			for (uint32_t ring = 0; ring <= max_ring; ++ring)
+			{
+				int64_t lo[3], hi[3];
+				for (int a = 0; a < 3; ++a) {
+					lo[a] = std::max<int64_t>(0, (int64_t)cc[a] - ring);
+					hi[a] = std::min<int64_t>((int64_t)_dims[a] - 1, (int64_t)cc[a] + ring);
+				}
+				for (int64_t z = lo[2]; z <= hi[2]; ++z)
+					for (int64_t y = lo[1]; y <= hi[1]; ++y)
+					{
+						// Only the shell of cells exactly `ring` steps from the center cell has not been visited yet
+						const size_t row = ((size_t)z * _dims[1] + (size_t)y) * _dims[0];
+						const bool shell_row = ring == 0 || z == (int64_t)cc[2] - ring || z == (int64_t)cc[2] + ring || y == (int64_t)cc[1] - ring || y == (int64_t)cc[1] + ring;
+						for (int64_t x = lo[0]; x <= hi[0]; ++x)
+						{
+							if (!shell_row && x != (int64_t)cc[0] - ring && x != (int64_t)cc[0] + ring) {
+								if (x < (int64_t)cc[0] + ring) x = (int64_t)cc[0] + ring - 1;
+								continue;
+							}
+							for (uint32_t i = _offsets[row + x], end = _offsets[row + x + 1]; i < end; ++i)
+							{
+								const uint32_t index = _indices[i];
+								const float d2 = distance_squared(c, _points[index]);
+								if (found < k) {
+									heap_ids[found] = index; heap_d2[found] = d2; ++found;
+									push_heap(heap_ids, heap_d2, found);
+								}
+								else if (d2 < heap_d2[0]) {
+									heap_ids[0] = index; heap_d2[0] = d2;
+									sift_down(heap_ids, heap_d2, 0, k);
+								}
+							}
+						}
+					}
+				// Every point not yet visited is at least as far away as the nearest face of the visited box of cells
+				if (found == k) {
+					float reach = INFINITY;
+					for (int a = 0; a < 3; ++a) {
+						if (lo[a] > 0) reach = std::min(reach, c[a] - (_min[a] + lo[a] * _cell_size));
+						if (hi[a] < (int64_t)_dims[a] - 1) reach = std::min(reach, _min[a] + (hi[a] + 1) * _cell_size - c[a]);
+					}
+					if (reach == INFINITY || (reach > 0 && reach * reach >= heap_d2[0])) break;
+				}
+			}
+			// Turn the max-heap into ascending order
+			for (size_t n = found; n > 1; --n) {
+				std::swap(heap_ids[0], heap_ids[n - 1]); std::swap(heap_d2[0], heap_d2[n - 1]);
+				sift_down(heap_ids, heap_d2, 0, n - 1);
+			}
+			return found;
+		}
+
+		// Runs a radius query for every point in `queries` in parallel. The results for query `q` are
+		// `out_indices[out_offsets[q]] .. out_indices[out_offsets[q + 1] - 1]`.
+		template<typename QueriesT>
+		void query_radius_batch(const QueriesT& queries, float radius, array<uint32_t>& out_offsets, array<uint32_t>& out_indices) const
+		{
+			const size_t n = queries.size();
+			out_offsets = array<uint32_t>(n + 1);
+			parallel_for(n, [&](size_t q) { out_offsets[q] = (uint32_t)query_radius(queries[q], radius, array_view<uint32_t>()); }, 256);
+			out_offsets[n] = 0;
+			const uint32_t total = parallel_exclusive_scan<uint32_t>(out_offsets);
+			out_indices = array<uint32_t>(total);
+			parallel_for(n, [&](size_t q) {
+				query_radius(queries[q], radius, array_view<uint32_t>(out_indices.begin() + out_offsets[q], out_offsets[q + 1] - out_offsets[q]));
+			}, 256);
+		}
+
+		// Runs a k-nearest query for every point in `queries` in parallel. The results for query `q` are at `q * k` in
+		// both outputs, which must hold `queries.size() * k` items. Unused slots are set to UINT32_MAX and infinity.
+		template<typename QueriesT>
+		void query_knn_batch(const QueriesT& queries, size_t k, array_view<uint32_t> out_indices, array_view<float> out_dist2) const
+		{
+			parallel_for(queries.size(), [&](size_t q) {
+				array_view<uint32_t> ids(out_indices.begin() + q * k, k);
+				array_view<float> d2(out_dist2.begin() + q * k, k);
+				for (size_t i = query_knn(queries[q], k, ids, d2); i < k; ++i) { ids[i] = UINT32_MAX; d2[i] = INFINITY; }
+			}, 256);
+		}
+
+	private:
+		template<typename P>
+		static float distance_squared(const float* c, const P& p)
+		{
+			typedef point_traits<P> pt;
+			const float dx = pt::x(p) - c[0], dy = pt::y(p) - c[1], dz = pt::z(p) - c[2];
+			return dx * dx + dy * dy + dz * dz;
+		}
+
+		static void push_heap(uint32_t* ids, float* d2, size_t n)
+		{
+			for (size_t i = n - 1; i > 0; ) {
+				const size_t parent = (i - 1) / 2;
+				if (!(d2[parent] < d2[i])) break;
+				std::swap(ids[parent], ids[i]); std::swap(d2[parent], d2[i]);
+				i = parent;
+			}
+		}
+
+		static void sift_down(uint32_t* ids, float* d2, size_t i, size_t n)
+		{
+			for (;;) {
+				size_t largest = i;
+				const size_t l = 2 * i + 1, r = l + 1;
+				if (l < n && d2[l] > d2[largest]) largest = l;
+				if (r < n && d2[r] > d2[largest]) largest = r;
+				if (largest == i) return;
+				std::swap(ids[largest], ids[i]); std::swap(d2[largest], d2[i]);
+				i = largest;
+			}
+		}
+
+		void compute_bounds(float cell_size)
+		{
+			const size_t n = _points.size();
+			float lo[3], hi[3];
+			point_bounds(_points, lo, hi);
+			float extent[3];
+			for (int a = 0; a < 3; ++a) {
+				_min[a] = lo[a];
+				extent[a] = hi[a] - lo[a];
+			}
+			if (!(cell_size > 0)) {
+				const float largest = std::max(extent[0], std::max(extent[1], extent[2]));
+				double volume = 1;
+				for (int a = 0; a < 3; ++a) volume *= std::max((double)extent[a], largest * 1e-3);
+				cell_size = (float)std::cbrt(volume * 2.0 / std::max<size_t>(n, 1));
+				if (!(cell_size > 0)) cell_size = 1;
+			}
+			// Grow the cells until the grid is no larger than a few cells per point, so the offsets stay addressable
+			const double max_cells = std::min(4.0 * std::max<size_t>(n, 1) + 64, 4294967294.0);
+			for (;;) {
+				double cells = 1;
+				for (int a = 0; a < 3; ++a) {
+					_dims[a] = (uint32_t)std::min(std::floor((double)extent[a] / cell_size) + 1, 4294967295.0 / 4);
+					cells *= _dims[a];
+				}
+				if (cells <= max_cells) break;
+				cell_size *= 1.25f;
+			}
+			_cell_size = cell_size;
+			_inv_cell_size = 1.0f / cell_size;
+		}
+	};
+
+	// Builds a spatial grid over an array of points, deducing the array type.
+	template<typename PointsT>
+	spatial_grid<PointsT> make_spatial_grid(const PointsT& points, float cell_size = 0)
+	{
+		return spatial_grid<PointsT>(points, cell_size);
+	}
+
+	// Interleaves the low 21 bits of x, y, and z into a 63-bit Morton (Z-order) code, with x in the lowest bit.
+	inline uint64_t morton_encode(uint32_t x, uint32_t y, uint32_t z)
+	{
+#if defined(ARA3D_BMI2)
+		return _pdep_u64(x, 0x1249249249249249ull) | _pdep_u64(y, 0x2492492492492492ull) | _pdep_u64(z, 0x4924924924924924ull);
+#else
+		struct spread
+		{
+			static uint64_t bits(uint64_t v)
+			{
+				v &= 0x1fffff;
+				v = (v | v << 32) & 0x1f00000000ffffull;
+				v = (v | v << 16) & 0x1f0000ff0000ffull;
+				v = (v | v << 8) & 0x100f00f00f00f00full;
+				v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+				v = (v | v << 2) & 0x1249249249249249ull;
+				return v;
+			}
+		};
+		return spread::bits(x) | spread::bits(y) << 1 | spread::bits(z) << 2;
+#endif
+	}
+
+	// Computes the 63-bit index of a point on a 3D Hilbert curve over a grid of 2^21 cells per axis.
+	// Consecutive indices are always adjacent cells, which gives better locality than Morton order at a slightly higher cost.
+	inline uint64_t hilbert_encode(uint32_t x, uint32_t y, uint32_t z)
+	{
+		// Skilling's transform from axes to the transposed Hilbert index
+		uint32_t v[3] = { x & 0x1fffff, y & 0x1fffff, z & 0x1fffff };
+		for (uint32_t q = 1u << 20; q > 1; q >>= 1) {
+			const uint32_t p = q - 1;
+			for (int i = 0; i < 3; ++i) {
+				if (v[i] & q) v[0] ^= p;
+				else { const uint32_t t = (v[0] ^ v[i]) & p; v[0] ^= t; v[i] ^= t; }
+			}
+		}
+		v[1] ^= v[0];
+		v[2] ^= v[1];
+		uint32_t t = 0;
+		for (uint32_t q = 1u << 20; q > 1; q >>= 1)
+			if (v[2] & q) t ^= q - 1;
+		for (int i = 0; i < 3; ++i) v[i] ^= t;
+		return morton_encode(v[2], v[1], v[0]);
+	}
+
+	namespace detail
+	{
+		template<typename PointsT, typename EncodeF>
+		void spatial_keys(const PointsT& points, array_view<uint64_t> out, EncodeF encode)
+		{
+			typedef point_traits<typename PointsT::value_type> traits;
+			float lo[3], hi[3], scale[3];
+			point_bounds(points, lo, hi);
+			for (int a = 0; a < 3; ++a) scale[a] = hi[a] > lo[a] ? 2097151.0f / (hi[a] - lo[a]) : 0.0f;
+			parallel_for(points.size(), [&](size_t i) {
+				const typename PointsT::value_type& p = points[i];
+				out[i] = encode(
+					(uint32_t)std::min((traits::x(p) - lo[0]) * scale[0], 2097151.0f),
+					(uint32_t)std::min((traits::y(p) - lo[1]) * scale[1], 2097151.0f),
+					(uint32_t)std::min((traits::z(p) - lo[2]) * scale[2], 2097151.0f));
+			});
+		}
+	}
+
+	// Writes the Morton code of each point, quantized to 21 bits per axis over the bounding box of all points, into `out`.
+	template<typename PointsT>
+	void morton_keys(const PointsT& points, array_view<uint64_t> out)
+	{
+		detail::spatial_keys(points, out, morton_encode);
+	}
+
+	// Writes the Hilbert index of each point, quantized to 21 bits per axis over the bounding box of all points, into `out`.
+	template<typename PointsT>
+	void hilbert_keys(const PointsT& points, array_view<uint64_t> out)
+	{
+		detail::spatial_keys(points, out, hilbert_encode);
+	}
+
+	// Vertex cache efficiency of a triangle list, measured with a FIFO cache simulation
+	struct vertex_cache_stats
+	{
+		size_t misses;
+		float acmr; // Average cache miss ratio: misses per triangle. 0.5 is ideal on large meshes, 3 is the worst.
+		float atvr; // Average transformed vertex ratio: misses per vertex referenced. 1 is ideal.
+	};
+
+	namespace detail
+	{
+		// Returns the smallest and one past the largest index, so meshes that reference a sub-range of a shared vertex buffer need only local tables
+		inline void index_range(const_array_view<uint32_t> indices, uint32_t& first, uint32_t& last)
+		{
+			first = UINT32_MAX; last = 0;
+			for (size_t i = 0; i < indices.size(); ++i) { first = std::min(first, indices[i]); last = std::max(last, indices[i] + 1); }
+			if (first > last) first = last = 0;
+		}
+	}
+
+	// Simulates a FIFO post-transform vertex cache of `cache_size` entries over a triangle list.
+	inline vertex_cache_stats analyze_vertex_cache(const_array_view<uint32_t> indices, size_t cache_size = 16)
+	{
+		uint32_t first, last;
+		detail::index_range(indices, first, last);
+		array<size_t> time_stamps(last - first);
+		for (size_t v = 0; v < time_stamps.size(); ++v) time_stamps[v] = 0;
+		size_t misses = 0, referenced = 0;
+		for (size_t i = 0; i < indices.size(); ++i) {
+			size_t& stamp = time_stamps[indices[i] - first];
+			if (stamp == 0) ++referenced;
+			if (stamp == 0 || misses + cache_size - stamp >= cache_size) stamp = ++misses + cache_size;
+		}
+		vertex_cache_stats r;
+		r.misses = misses;
+		r.acmr = indices.size() < 3 ? 0.0f : (float)misses / (float)(indices.size() / 3);
+		r.atvr = referenced == 0 ? 0.0f : (float)misses / (float)referenced;
+		return r;
+	}
+
+	// Reorders the triangles of a triangle list in place for a vertex cache of `cache_size` entries,
+	// using the Tipsify algorithm (Sander, Nehab, and Barczak 2007), which runs in linear time.
+	inline void optimize_vertex_cache(array_view<uint32_t> indices, size_t cache_size = 16)
+	{
+		const size_t triangles = indices.size() / 3;
+		uint32_t first, last;
+		detail::index_range(const_array_view<uint32_t>(indices.begin(), triangles * 3), first, last);
+		const size_t vertices = last - first;
+		if (triangles < 2) return;
+
+		// Vertex to triangle adjacency in compressed sparse row form 
+		array<uint32_t> live(vertices), offsets(vertices + 1), adjacency(triangles * 3);
+		for (size_t v = 0; v <= vertices; ++v) offsets[v] = 0;
+		for (size_t i = 0; i < triangles * 3; ++i) ++offsets[indices[i] - first];
+		for (size_t v = 0; v < vertices; ++v) live[v] = offsets[v];
+		parallel_exclusive_scan<uint32_t>(offsets);
+		for (size_t i = 0; i < triangles * 3; ++i) adjacency[offsets[indices[i] - first]++] = (uint32_t)(i / 3);
+		for (size_t v = vertices; v > 0; --v) offsets[v] = offsets[v - 1];
+		offsets[0] = 0;
+
+		array<size_t> cache_time(vertices);
+		for (size_t v = 0; v < vertices; ++v) cache_time[v] = 0;
+		array<bool> emitted(triangles);
+		for (size_t t = 0; t < triangles; ++t) emitted[t] = false;
+		array<uint32_t> output(triangles * 3), dead_end(triangles * 3);
+		size_t output_size = 0, dead_end_size = 0, cursor = 1;
+		size_t time = cache_size + 1;
+		for (int64_t fan = 0; fan >= 0; )
+		{
+			// Emit every remaining triangle around the fanning vertex, tracking the candidates for the next fan
+			const size_t candidates_begin = dead_end_size;
+			for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; ++a)
+			{
+				const uint32_t t = adjacency[a];
+				if (emitted[t]) continue;
+				emitted[t] = true;
+				for (int c = 0; c < 3; ++c) {
+					const uint32_t v = indices[t * 3 + c] - first;
+					output[output_size++] = v;
+					dead_end[dead_end_size++] = v;
+					--live[v];
+					if (time - cache_time[v] > cache_size) cache_time[v] = time++;
+				}
+			}
+
+			// Prefer the candidate that is in the cache and will stay there while its remaining triangles are emitted
+			fan = -1;
+			int64_t best = -1;
+			for (size_t i = candidates_begin; i < dead_end_size; ++i) {
+				const uint32_t v = dead_end[i];
+				if (live[v] == 0) continue;
+				const int64_t priority = time - cache_time[v] + 2 * live[v] <= cache_size ? (int64_t)(time - cache_time[v]) : 0;
+				if (priority > best) { best = priority; fan = v; }
+			}
+			// Otherwise fall back to the most recently used vertex with triangles left, then to the next one in order
+			while (fan < 0 && dead_end_size > 0) {
+				const uint32_t v = dead_end[--dead_end_size];
+				if (live[v] > 0) fan = v;
+			}
+			while (fan < 0 && cursor < vertices) {
+				if (live[cursor] > 0) fan = (int64_t)cursor;
+				++cursor;
+			}
+		}
+		for (size_t i = 0; i < output_size; ++i) indices[i] = output[i] + first;
+	}
+
+	// Reorders the triangles of many meshes in parallel. The indices of mesh `m` are `indices[mesh_offsets[m]] .. indices[mesh_offsets[m + 1] - 1]`.
+	inline void optimize_vertex_cache_meshes(array_view<uint32_t> indices, const_array_view<uint32_t> mesh_offsets, size_t cache_size = 16)
+	{
+		if (mesh_offsets.size() < 2) return;
+		parallel_for(mesh_offsets.size() - 1, [&](size_t m) {
+			optimize_vertex_cache(array_view<uint32_t>(indices.begin() + mesh_offsets[m], mesh_offsets[m + 1] - mesh_offsets[m]), cache_size);
+		}, 1);
+	}
+
+	// Renumbers vertices in the order they are first referenced by the triangles, so vertex fetches walk memory
+	// sequentially. The indices are rewritten in place, and each vertex array (e.g. positions, normals, and uvs,
+	// as contiguous or strided views) is reordered to match in a single pass. Vertices that are never referenced
+	// are moved to the end. Returns the number of referenced vertices.
+	template<typename... VertexViewsT>
+	size_t optimize_vertex_fetch(array_view<uint32_t> indices, VertexViewsT&... vertices)
+	{
+		size_t vertex_count = 0;
+		size_t sizes[] = { vertices.size()..., 0 };
+		for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) vertex_count = std::max(vertex_count, sizes[i]);
+		for (size_t i = 0; i < indices.size(); ++i) vertex_count = std::max(vertex_count, (size_t)indices[i] + 1);
+		array<uint32_t> remap(vertex_count), permutation(vertex_count);
+		for (size_t v = 0; v < vertex_count; ++v) remap[v] = UINT32_MAX;
+		uint32_t next = 0;
+		for (size_t i = 0; i < indices.size(); ++i) {
+			uint32_t& r = remap[indices[i]];
+			if (r == UINT32_MAX) { permutation[next] = indices[i]; r = next++; }
+			indices[i] = r;
+		}
+		const size_t referenced = next;
+		for (size_t v = 0; v < vertex_count; ++v)
+			if (remap[v] == UINT32_MAX) permutation[next++] = (uint32_t)v;
+		reorder(permutation, vertices...);
+		return referenced;
+	}
+
+	// Computes the unit normal of each triangle, with counter-clockwise winding facing outwards, into `normals`, which
+	// can be any mutable array of points (e.g. `array_view<float3>` or a strided view) with one item per triangle.
+	// Degenerate triangles get a zero normal.
+	template<typename PointsT, typename NormalsT>
+	void compute_face_normals(const_array_view<uint32_t> indices, const PointsT& positions, NormalsT&& normals)
+	{
+		parallel_for(indices.size() / 3, [&](size_t t) {
+			float a[3], b[3], c[3], n[3];
+			detail::get_point(positions[indices[t * 3]], a);
+			detail::get_point(positions[indices[t * 3 + 1]], b);
+			detail::get_point(positions[indices[t * 3 + 2]], c);
+			for (int i = 0; i < 3; ++i) { b[i] -= a[i]; c[i] -= a[i]; }
+			detail::cross(b, c, n);
+			detail::normalize(n);
+			detail::set_point(normals[t], n);
+		});
+	}
+
+	// Computes area weighted unit vertex normals into `normals`, which has one item per vertex. The triangles around each
+	// vertex are grouped first so every vertex is summed by a single thread, without atomics or per-thread copies.
+	template<typename PointsT, typename NormalsT>
+	void compute_vertex_normals(const_array_view<uint32_t> indices, const PointsT& positions, NormalsT&& normals)
+	{
+		const size_t triangles = indices.size() / 3;
+		const_array_view<uint32_t> corners(indices.begin(), triangles * 3);
+		// The length of the cross product is twice the area of the triangle, which gives the weighting for free
+		array<float3> face_normals(triangles);
+		parallel_for(triangles, [&](size_t t) {
+			float a[3], b[3], c[3];
+			detail::get_point(positions[indices[t * 3]], a);
+			detail::get_point(positions[indices[t * 3 + 1]], b);
+			detail::get_point(positions[indices[t * 3 + 2]], c);
+			for (int i = 0; i < 3; ++i) { b[i] -= a[i]; c[i] -= a[i]; }
+			detail::cross(b, c, &face_normals[t].x);
+		});
+		array<uint32_t> offsets, vertex_corners;
+		counting_sort_by_key(corners, normals.size(), offsets, vertex_corners);
+		parallel_for(normals.size(), [&](size_t v) {
+			float n[3] = { 0, 0, 0 };
+			for (uint32_t i = offsets[v]; i < offsets[v + 1]; ++i) {
+				const float3& f = face_normals[vertex_corners[i] / 3];
+				n[0] += f.x; n[1] += f.y; n[2] += f.z;
+			}
+			detail::normalize(n);
+			detail::set_point(normals[v], n);
+		});
+	}
+
+	// Computes per-vertex tangents from texture coordinates (Lengyel's method) into `tangents`, whose items have x, y, z,
+	// and w members, such as `float4`. Texture coordinates are items with x and y members. Tangents are made orthogonal to
+	// the unit vertex normals, and w is the handedness (+1 or -1) of the bitangent, which is cross(normal, tangent) * w.
+	template<typename PointsT, typename UVsT, typename NormalsT, typename TangentsT>
+	void compute_vertex_tangents(const_array_view<uint32_t> indices, const PointsT& positions, const UVsT& uvs, const NormalsT& normals, TangentsT&& tangents)
+	{
+		const size_t triangles = indices.size() / 3;
+		const_array_view<uint32_t> corners(indices.begin(), triangles * 3);
+		array<float3> face_tangents(triangles), face_bitangents(triangles);
+		parallel_for(triangles, [&](size_t t) {
+			const uint32_t i0 = indices[t * 3], i1 = indices[t * 3 + 1], i2 = indices[t * 3 + 2];
+			float p0[3], e1[3], e2[3];
+			detail::get_point(positions[i0], p0);
+			detail::get_point(positions[i1], e1);
+			detail::get_point(positions[i2], e2);
+			for (int i = 0; i < 3; ++i) { e1[i] -= p0[i]; e2[i] -= p0[i]; }
+			const float s1 = (float)uvs[i1].x - (float)uvs[i0].x, t1 = (float)uvs[i1].y - (float)uvs[i0].y;
+			const float s2 = (float)uvs[i2].x - (float)uvs[i0].x, t2 = (float)uvs[i2].y - (float)uvs[i0].y;
+			const float det = s1 * t2 - s2 * t1;
+			const float r = det != 0 ? 1.0f / det : 0.0f;
+			float3& tangent = face_tangents[t];
+			float3& bitangent = face_bitangents[t];
+			tangent.x = (e1[0] * t2 - e2[0] * t1) * r; tangent.y = (e1[1] * t2 - e2[1] * t1) * r; tangent.z = (e1[2] * t2 - e2[2] * t1) * r;
+			bitangent.x = (e2[0] * s1 - e1[0] * s2) * r; bitangent.y = (e2[1] * s1 - e1[1] * s2) * r; bitangent.z = (e2[2] * s1 - e1[2] * s2) * r;
+		});
+		array<uint32_t> offsets, vertex_corners;
+		counting_sort_by_key(corners, tangents.size(), offsets, vertex_corners);
+		parallel_for(tangents.size(), [&](size_t v) {
+			float t[3] = { 0, 0, 0 }, b[3] = { 0, 0, 0 }, n[3], nxt[3];
+			for (uint32_t i = offsets[v]; i < offsets[v + 1]; ++i) {
+				const size_t f = vertex_corners[i] / 3;
+				t[0] += face_tangents[f].x; t[1] += face_tangents[f].y; t[2] += face_tangents[f].z;
+				b[0] += face_bitangents[f].x; b[1] += face_bitangents[f].y; b[2] += face_bitangents[f].z;
+			}
+			detail::get_point(normals[v], n);
+			// Gram-Schmidt orthogonalization against the normal
+			const float d = detail::dot(n, t);
+			for (int i = 0; i < 3; ++i) t[i] -= n[i] * d;
+			detail::normalize(t);
+			detail::cross(n, t, nxt);
+			auto& out = tangents[v];
+			out.x = t[0]; out.y = t[1]; out.z = t[2];
+			out.w = detail::dot(nxt, b) < 0 ? -1.0f : 1.0f;
+		});
+	}
+
+	// The edge connectivity of a triangle list. Edge `3 * t + k` of triangle `t` runs from corner `k` to corner `(k + 1) % 3`.
+	struct triangle_adjacency
+	{
+		array<uint32_t> opposite;     // The matching edge of the neighboring triangle, or UINT32_MAX if there is none
+		array<uint32_t> boundary;     // The edges used by only one triangle, in ascending order
+		array<uint32_t> non_manifold; // The edges shared by more than two triangles, or by two triangles with inconsistent winding
+
+		uint32_t neighbor(uint32_t edge) const { return opposite[edge] == UINT32_MAX ? UINT32_MAX : opposite[edge] / 3; }
+		bool is_closed_manifold() const { return boundary.size() == 0 && non_manifold.size() == 0; }
+	};
+
+	namespace detail
+	{
+		// Returns the edges whose flag equals `value`, in ascending order
+		inline array<uint32_t> select_edges(const_array_view<uint8_t> flags, uint8_t value)
+		{
+			const size_t n = flags.size();
+			const size_t parts = n < 65536 ? 1 : concurrency();
+			array<size_t> offsets(parts);
+			parallel_partition(n, parts, [&](size_t p, size_t first, size_t last) {
+				size_t count = 0;
+				for (size_t i = first; i < last; ++i) count += flags[i] == value;
+				offsets[p] = count;
+			});
+			array<uint32_t> r(parallel_exclusive_scan<size_t>(offsets));
+			parallel_partition(n, parts, [&](size_t p, size_t first, size_t last) {
+				size_t k = offsets[p];
+				for (size_t i = first; i < last; ++i) if (flags[i] == value) r[k++] = (uint32_t)i;
+			});
+			return r;
+		}
+	}
+
+	// Finds the neighbors of every triangle across each of its edges. The edges are sorted by their (lower, higher) vertex
+	// pair with two passes of a parallel counting sort, so the uses of each undirected edge are adjacent and are matched
+	// in time linear in their number, however many triangles share a vertex. No hash table of edges is needed. Pass the
+	// vertex count if it is known, otherwise it is taken from the largest index.
+	inline triangle_adjacency build_triangle_adjacency(const_array_view<uint32_t> indices, size_t vertex_count = 0)
+	{
+		enum { paired, boundary, non_manifold, degenerate };
+		const size_t edges = indices.size() / 3 * 3;
+		if (vertex_count == 0) {
+			atomic_array_view<size_t> max_vertex(&vertex_count, 1);
+			parallel_for_blocks(edges, [&](size_t first, size_t last) {
+				uint32_t m = 0;
+				for (size_t i = first; i < last; ++i) m = std::max(m, indices[i]);
+				max_vertex.fetch_max(0, (size_t)m + 1);
+			});
+		}
+		auto from = [&](size_t e) { return indices[e]; };
+		auto to = [&](size_t e) { return indices[e % 3 == 2 ? e - 2 : e + 1]; };
+		// Sort by the higher vertex, then stably by the lower one
+		array<uint32_t> keys(edges);
+		parallel_for(edges, [&](size_t e) { keys[e] = std::max(from(e), to(e)); });
+		array<uint32_t> offsets, by_high, rows;
+		counting_sort_by_key(keys, vertex_count, offsets, by_high);
+		parallel_for(edges, [&](size_t i) { const uint32_t e = by_high[i]; keys[i] = std::min(from(e), to(e)); });
+		counting_sort_by_key(keys, vertex_count, offsets, rows);
+		array<uint32_t> grouped(edges);
+		parallel_for(edges, [&](size_t i) { grouped[i] = by_high[rows[i]]; });
+		triangle_adjacency r;
+		r.opposite = array<uint32_t>(edges);
+		array<uint8_t> kinds(edges);
+		parallel_for(vertex_count, [&](size_t v) {
+			for (uint32_t i = offsets[v], end; i < offsets[v + 1]; i = end) {
+				// The run of uses of one undirected edge from `v`, counted by direction
+				const uint32_t high = std::max(from(grouped[i]), to(grouped[i]));
+				size_t forward = 0, backward = 0;
+				uint32_t last_forward = UINT32_MAX, last_backward = UINT32_MAX;
+				for (end = i; end < offsets[v + 1]; ++end) {
+					const uint32_t e = grouped[end];
+					if (std::max(from(e), to(e)) != high) break;
+					if (from(e) == v) { ++forward; last_forward = e; }
+					else { ++backward; last_backward = e; }
+				}
+				for (uint32_t j = i; j < end; ++j) {
+					const uint32_t e = grouped[j];
+					r.opposite[e] = UINT32_MAX;
+					if (high == v) { kinds[e] = degenerate; continue; }
+					const bool is_forward = from(e) == v;
+					const size_t same = (is_forward ? forward : backward) - 1, reversed = is_forward ? backward : forward;
+					if (same + reversed == 0) kinds[e] = boundary;
+					else if (same == 0 && reversed == 1) { kinds[e] = paired; r.opposite[e] = is_forward ? last_backward : last_forward; }
+					else kinds[e] = non_manifold;
+				}
+			}
+		}, 256);
+		const_array_view<uint8_t> flags(kinds.begin(), kinds.size());
+		r.boundary = detail::select_edges(flags, boundary);
+		r.non_manifold = detail::select_edges(flags, non_manifold);
+		return r;
+	}
+
+	// A triangle mesh produced by the simplifier. When several meshes are simplified together, the triangles of mesh `m`
+	// are `indices[index_offsets[m]] .. indices[index_offsets[m + 1] - 1]`, and they only use the positions
+	// `vertex_offsets[m] .. vertex_offsets[m + 1] - 1`.
+	struct simplified_mesh
+	{
+		array<float3> positions;
+		array<uint32_t> indices;
+		array<uint32_t> index_offsets;
+		array<uint32_t> vertex_offsets;
+	};
+
+	namespace detail
+	{
+		// The sum of squared distances to a set of weighted planes, as a symmetric 4x4 matrix, and the sum of the weights
+		struct quadric
+		{
+			double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2, w;
+
+			void add_plane(const float* n, float d, double w)
+			{
+				this->w += w;
+				a2 += w * n[0] * n[0]; ab += w * n[0] * n[1]; ac += w * n[0] * n[2]; ad += w * n[0] * d;
+				b2 += w * n[1] * n[1]; bc += w * n[1] * n[2]; bd += w * n[1] * d;
+				c2 += w * n[2] * n[2]; cd += w * n[2] * d;
+				d2 += w * d * d;
+			}
+
+			void add(const quadric& q)
+			{
+				a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2; bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2; w += q.w;
+			}
+
+			double error(const float3& p) const
+			{
+				const double x = p.x, y = p.y, z = p.z;
+				const double e = a2 * x * x + b2 * y * y + c2 * z * z + d2
+					+ 2 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z);
+				return e > 0 ? e : 0;
+			}
+		};
+
+		// The weighted mean squared distance from `p` to the planes of two quadrics. Dividing by the weights makes it a
+		// squared distance, whatever the scale of the model, where the sum alone would be area times squared distance.
+		inline double collapse_error(const quadric& a, const quadric& b, const float3& p)
+		{
+			const double w = a.w + b.w;
+			return w > 0 ? (a.error(p) + b.error(p)) / w : 0;
+		}
+
+		// Lists the triangles around each vertex in CSR form: those of `v` are `triangles[offsets[v]] .. triangles[offsets[v + 1] - 1]`
+		inline void vertex_triangles(const_array_view<uint32_t> indices, size_t vertices, array<uint32_t>& offsets, array<uint32_t>& triangles)
+		{
+			offsets = array<uint32_t>(vertices + 1);
+			for (size_t v = 0; v <= vertices; ++v) offsets[v] = 0;
+			for (size_t i = 0; i < indices.size(); ++i) ++offsets[indices[i] + 1];
+			for (size_t v = 0; v < vertices; ++v) offsets[v + 1] += offsets[v];
+			triangles = array<uint32_t>(indices.size());
+			array<uint32_t> cursor(vertices);
+			for (size_t v = 0; v < vertices; ++v) cursor[v] = offsets[v];
+			for (size_t i = 0; i < indices.size(); ++i) triangles[cursor[indices[i]]++] = (uint32_t)(i / 3);
+		}
+
+		inline void sub(const float3& a, const float3& b, float* out)
+		{
+			out[0] = a.x - b.x; out[1] = a.y - b.y; out[2] = a.z - b.z;
+		}
+
+		inline void triangle_normal(const float3& a, const float3& b, const float3& c, float* out)
+		{
+			float e1[3], e2[3];
+			sub(b, a, e1);
+			sub(c, a, e2);
+			cross(e1, e2, out);
+		}
+
+		// Simplifies the triangle list in place, removing collapsed triangles from the end, and returns the remaining
+		// triangle count. Works in passes: every edge is given the quadric error of collapsing one end into the other,
+		// and the cheapest collapses are applied greedily, each one locking the ring of vertices around it until the
+		// next pass so the checks of later collapses in the same pass stay valid. Vertices keep their positions, so a
+		// collapse never moves the surface around the vertex that is kept.
+		inline size_t simplify_triangles(const array<float3>& positions, array<uint32_t>& indices, size_t target_triangles, double max_error, bool parallel)
+		{
+			const size_t vertices = positions.size();
+			size_t triangles = indices.size() / 3;
+			array<uint32_t> offsets, around;
+			// Flags the edges used by only one triangle, from the adjacency of the current triangles
+			array<uint8_t> border_edge;
+			auto find_border_edges = [&]() {
+				const triangle_adjacency adjacency = build_triangle_adjacency(const_array_view<uint32_t>(indices.begin(), triangles * 3), vertices);
+				border_edge = array<uint8_t>(triangles * 3);
+				for (size_t e = 0; e < border_edge.size(); ++e) border_edge[e] = 0;
+				for (size_t i = 0; i < adjacency.boundary.size(); ++i) border_edge[adjacency.boundary[i]] = 1;
+			};
+
+			// Faces contribute their plane weighted by area, and border edges a perpendicular plane, so borders hold their shape
+			const double border_weight = 10;
+			array<quadric> quadrics(vertices);
+			array<uint8_t> border(vertices);
+			vertex_triangles(const_array_view<uint32_t>(indices.begin(), triangles * 3), vertices, offsets, around);
+			find_border_edges();
+			for (size_t v = 0; v < vertices; ++v) {
+				quadrics[v] = quadric();
+				border[v] = 0;
+				for (uint32_t i = offsets[v]; i < offsets[v + 1]; ++i) {
+					const uint32_t* t = indices.begin() + around[i] * 3;
+					float n[3];
+					triangle_normal(positions[t[0]], positions[t[1]], positions[t[2]], n);
+					const float area = std::sqrt(dot(n, n)) * 0.5f;
+					normalize(n);
+					quadrics[v].add_plane(n, -dot(n, &positions[t[0]].x), area);
+					for (int k = 0; k < 3; ++k) {
+						const uint32_t a = t[k], b = t[(k + 1) % 3];
+						if ((a != v && b != v) || a == b || !border_edge[around[i] * 3 + k]) continue;
+						float e[3], p[3];
+						sub(positions[b], positions[a], e);
+						cross(e, n, p);
+						normalize(p);
+						quadrics[v].add_plane(p, -dot(p, &positions[a].x), dot(e, e) * border_weight);
+						border[v] = 1;
+					}
+				}
+			}
+
+			array<uint32_t> remap(vertices), order, stamps(vertices);
+			array<uint8_t> locked(vertices);
+			for (size_t pass = 0; triangles > target_triangles; ++pass) {
+				if (pass != 0) {
+					vertex_triangles(const_array_view<uint32_t>(indices.begin(), triangles * 3), vertices, offsets, around);
+					find_border_edges();
+				}
+
+				// A border vertex may only slide along the border, into the other end of a border edge
+				const size_t edges = triangles * 3;
+				array<uint32_t> from(edges), to(edges);
+				array<double> costs(edges);
+				array<uint8_t> allowed(edges);
+				auto cost_edge = [&](size_t e) {
+					uint32_t a = indices[e], b = indices[e % 3 == 2 ? e - 2 : e + 1];
+					const bool along_border = border[a] && border[b] && border_edge[e];
+					bool allow_ab = a != b && (!border[a] || along_border);
+					bool allow_ba = a != b && (!border[b] || along_border);
+					double ab = allow_ab ? collapse_error(quadrics[a], quadrics[b], positions[b]) : HUGE_VAL;
+					double ba = allow_ba ? collapse_error(quadrics[a], quadrics[b], positions[a]) : HUGE_VAL;
+					if (allow_ba && (!allow_ab || ba < ab)) { std::swap(a, b); ab = ba; }
+					from[e] = a; to[e] = b; costs[e] = ab;
+					// Forbidden collapses are flagged rather than only given a huge cost, which an unlimited error would let through
+					allowed[e] = allow_ab || allow_ba;
+				};
+				if (parallel) parallel_for(edges, cost_edge);
+				else for (size_t e = 0; e < edges; ++e) cost_edge(e);
+				order = array<uint32_t>(edges);
+				for (size_t e = 0; e < edges; ++e) order[e] = (uint32_t)e;
+				std::sort(order.begin(), order.end(), [&](uint32_t x, uint32_t y) { return costs[x] < costs[y]; });
+
+				for (size_t v = 0; v < vertices; ++v) { remap[v] = (uint32_t)v; locked[v] = 0; stamps[v] = 0; }
+				size_t removed = 0, collapses = 0;
+				uint32_t stamp = 0;
+				for (size_t i = 0; i < edges && triangles - removed > target_triangles; ++i) {
+					const uint32_t e = order[i];
+					if (!allowed[e]) continue;
+					if (!(costs[e] <= max_error)) break;
+					const uint32_t a = from[e], b = to[e];
+					if (locked[a] || locked[b]) continue;
+
+					// Keep the topology: the vertices around both ends must be exactly those of the triangles they share.
+					// Reject collapses that would flip a triangle over.
+					size_t shared = 0, common = 0;
+					bool flips = false;
+					for (uint32_t j = offsets[a]; j < offsets[a + 1] && !flips; ++j) {
+						const uint32_t* t = indices.begin() + around[j] * 3;
+						if (t[0] == b || t[1] == b || t[2] == b) { ++shared; continue; }
+						float before[3], after[3];
+						triangle_normal(positions[t[0]], positions[t[1]], positions[t[2]], before);
+						triangle_normal(positions[t[0] == a ? b : t[0]], positions[t[1] == a ? b : t[1]], positions[t[2] == a ? b : t[2]], after);
+						flips = dot(before, after) <= 0;
+					}
+					if (flips) continue;
+					// Stamp the neighbors of `a`, then count those found around `b`, restamping each so it is counted once
+					const uint32_t neighbor = ++stamp, counted = ++stamp;
+					for (uint32_t j = offsets[a]; j < offsets[a + 1]; ++j) {
+						const uint32_t* t = indices.begin() + around[j] * 3;
+						for (int k = 0; k < 3; ++k) stamps[t[k]] = neighbor;
+					}
+					for (uint32_t j = offsets[b]; j < offsets[b + 1]; ++j) {
+						const uint32_t* t = indices.begin() + around[j] * 3;
+						for (int k = 0; k < 3; ++k) {
+							const uint32_t w = t[k];
+							if (w == a || w == b || stamps[w] != neighbor) continue;
+							stamps[w] = counted;
+							++common;
+						}
+					}
+					if (common != shared) continue;
+
+					remap[a] = b;
+					quadrics[b].add(quadrics[a]);
+					for (uint32_t j = offsets[a]; j < offsets[a + 1]; ++j) {
+						const uint32_t* t = indices.begin() + around[j] * 3;
+						locked[t[0]] = locked[t[1]] = locked[t[2]] = 1;
+					}
+					removed += shared;
+					++collapses;
+				}
+				if (collapses == 0) break;
+
+				size_t kept = 0;
+				for (size_t t = 0; t < triangles; ++t) {
+					const uint32_t x = remap[indices[t * 3]], y = remap[indices[t * 3 + 1]], z = remap[indices[t * 3 + 2]];
+					if (x == y || y == z || z == x) continue;
+					indices[kept * 3] = x; indices[kept * 3 + 1] = y; indices[kept * 3 + 2] = z;
+					++kept;
+				}
+				triangles = kept;
+			}
+			return triangles;
+		}
+
+		// Copies the vertices of a mesh into local storage and simplifies it, then appends the used vertices in first use
+		// order and the renumbered triangles to the outputs
+		template<typename PointsT>
+		void simplify_one(const PointsT& positions, const_array_view<uint32_t> indices, size_t target_triangles, float max_error, bool parallel, dynamic_array<float3>& out_positions, dynamic_array<uint32_t>& out_indices)
+		{
+			array<uint32_t> local(indices.size());
+			for (size_t i = 0; i < local.size(); ++i) local[i] = indices[i];
+			std::sort(local.begin(), local.end());
+			const size_t vertices = std::unique(local.begin(), local.end()) - local.begin();
+			array<float3> points(vertices);
+			for (size_t v = 0; v < vertices; ++v) get_point(positions[local[v]], &points[v].x);
+			array<uint32_t> triangles(indices.size() / 3 * 3);
+			for (size_t i = 0; i < triangles.size(); ++i) triangles[i] = (uint32_t)(std::lower_bound(local.begin(), local.begin() + vertices, indices[i]) - local.begin());
+			const size_t kept = simplify_triangles(points, triangles, target_triangles, (double)max_error * max_error, parallel);
+			for (size_t v = 0; v < vertices; ++v) local[v] = UINT32_MAX;
+			for (size_t i = 0; i < kept * 3; ++i) {
+				uint32_t& r = local[triangles[i]];
+				if (r == UINT32_MAX) { r = (uint32_t)out_positions.size(); out_positions.push_back(points[triangles[i]]); }
+				out_indices.push_back(r);
+			}
+		}
+	}
+
+	// Reduces a triangle mesh to about `target_triangles` triangles by quadric error edge collapse (Garland and Heckbert),
+	// stopping early if the next collapse would move the surface further than `max_error`, measured as the area weighted
+	// root mean square distance of the new vertex position from the planes of the original triangles merged into it.
+	// Positions can be any array of points, and the result has only the vertices that are still used, in first use order.
+	template<typename PointsT>
+	simplified_mesh simplify_mesh(const PointsT& positions, const_array_view<uint32_t> indices, size_t target_triangles, float max_error = HUGE_VALF)
+	{
+		dynamic_array<float3> out_positions;
+		dynamic_array<uint32_t> out_indices;
+		detail::simplify_one(positions, indices, target_triangles, max_error, true, out_positions, out_indices);
+		simplified_mesh r;
+		r.index_offsets = array<uint32_t>(2);
+		r.vertex_offsets = array<uint32_t>(2);
+		r.index_offsets[0] = r.vertex_offsets[0] = 0;
+		r.index_offsets[1] = (uint32_t)out_indices.size();
+		r.vertex_offsets[1] = (uint32_t)out_positions.size();
+		r.positions = out_positions.finish();
+		r.indices = out_indices.finish();
+		return r;
+	}
+
+	// Simplifies many meshes in parallel, each to `ratio` of its triangles. The indices of mesh `m` are
+	// `indices[mesh_offsets[m]] .. indices[mesh_offsets[m + 1] - 1]`, and meshes may share vertices. Each mesh gets its
+	// own copy of the vertices it keeps in the result, so the output meshes are independent.
+	template<typename PointsT>
+	simplified_mesh simplify_meshes(const PointsT& positions, const_array_view<uint32_t> indices, const_array_view<uint32_t> mesh_offsets, float ratio, float max_error = HUGE_VALF)
+	{
+		const size_t meshes = mesh_offsets.size() < 2 ? 0 : mesh_offsets.size() - 1;
+		array<dynamic_array<float3>> mesh_positions(meshes);
+		array<dynamic_array<uint32_t>> mesh_indices(meshes);
+		parallel_for(meshes, [&](size_t m) {
+			const_array_view<uint32_t> mesh(indices.begin() + mesh_offsets[m], mesh_offsets[m + 1] - mesh_offsets[m]);
+			detail::simplify_one(positions, mesh, (size_t)(ratio * (mesh.size() / 3)), max_error, false, mesh_positions[m], mesh_indices[m]);
+		}, 1);
+		simplified_mesh r;
+		r.index_offsets = array<uint32_t>(meshes + 1);
+		r.vertex_offsets = array<uint32_t>(meshes + 1);
+		for (size_t m = 0; m < meshes; ++m) {
+			r.index_offsets[m] = (uint32_t)mesh_indices[m].size();
+			r.vertex_offsets[m] = (uint32_t)mesh_positions[m].size();
+		}
+		r.index_offsets[meshes] = r.vertex_offsets[meshes] = 0;
+		r.positions = array<float3>(parallel_exclusive_scan<uint32_t>(r.vertex_offsets));
+		r.indices = array<uint32_t>(parallel_exclusive_scan<uint32_t>(r.index_offsets));
+		parallel_for(meshes, [&](size_t m) {
+			std::copy(mesh_positions[m].begin(), mesh_positions[m].end(), r.positions.begin() + r.vertex_offsets[m]);
+			for (size_t i = 0; i < mesh_indices[m].size(); ++i) r.indices[r.index_offsets[m] + i] = mesh_indices[m][i] + r.vertex_offsets[m];
+		}, 1);
+		return r;
+	}
+}
@@ -0,0 +1,90 @@
+/*
+	Ara 3d Array Library - Memory Mapped Storage
+	Copyright 2018, Ara 3D, Inc.
+	Usage licensed under terms of MIT Licenese
+*/
+#pragma once
+
+#include "array.h"
+#include <type_traits>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace ara3d
+{
+	// A `dynamic_array` storage policy that keeps large buffers of trivially copyable items in their own anonymous memory
+	// mapping on Linux, so growing, `shrink_to_fit`, and `finish` remap pages with mremap instead of copying the items.
+	// Smaller buffers, other item types, and other platforms use new[] like `heap_storage`.
+	template<typename T>
+	struct mapped_storage
+	{
+		// Buffers of at least this many bytes are memory mapped, when supported
+		static const size_t mapped_threshold = 1 << 20;
+
+		bool _mapped;
+
+		mapped_storage() : _mapped(false) { }
+
+		T* reallocate(T* data, size_t size, size_t old_capacity, size_t& capacity)
+		{
+#if defined(__linux__)
+			if (std::is_trivially_copyable<T>::value && capacity * sizeof(T) >= mapped_threshold) {
+				// Round up to whole pages so none of the mapping is wasted
+				const size_t bytes = (capacity * sizeof(T) + 4095) & ~(size_t)4095;
+				void* p = _mapped
+					? mremap(data, old_capacity * sizeof(T), bytes, MREMAP_MAYMOVE)
+					: mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+				if (p != MAP_FAILED) {
+					if (!_mapped) {
+						for (size_t i = 0; i < size; ++i) ((T*)p)[i] = data[i];
+						delete[] data;
+					}
+					capacity = bytes / sizeof(T);
+					_mapped = true;
+					return (T*)p;
+				}
+			}
+			if (_mapped) {
+				T* r = new T[capacity];
+				for (size_t i = 0; i < size; ++i) r[i] = data[i];
+				munmap(data, old_capacity * sizeof(T));
+				_mapped = false;
+				return r;
+			}
+#endif
+			return heap_storage<T>().reallocate(data, size, old_capacity, capacity);
+		}
+
+		void release(T* data, size_t capacity)
+		{
+#if defined(__linux__)
+			if (_mapped) { munmap(data, capacity * sizeof(T)); return; }
+#endif
+			delete[] data;
+		}
+
+		// Transfers a buffer to an array. Mapped buffers are shrunk to size first, and small ones move back to new[].
+		array<T> finish(T* data, size_t size, size_t capacity)
+		{
+#if defined(__linux__)
+			if (_mapped) {
+				size_t shrunk = size;
+				data = reallocate(data, size, capacity, shrunk);
+				if (_mapped) return array<T>(data, size, unmap);
+			}
+#endif
+			return array<T>(data, size, nullptr);
+		}
+
+	private:
+#if defined(__linux__)
+		static void unmap(T* data, size_t size) { munmap(data, size * sizeof(T)); }
+#endif
+	};
+
+	// A growable array whose large buffers are grown and shrunk by remapping pages
+	template<typename T>
+	using mapped_dynamic_array = dynamic_array<T, array_view<T>, mapped_storage<T>>;
+}
@@ -0,0 +1,142 @@
+/*
+	Ara 3d Array Library - Random Arrays
+	Copyright 2018, Ara 3D, Inc.
+	Usage licensed under terms of MIT Licenese
+*/
+#pragma once
+
+#include "array.h"
+#include <cmath>
+#include <cstdint>
+
+namespace ara3d
+{
+	// The Philox4x32-10 counter-based generator (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+	// It maps a 128-bit counter and a 64-bit key to 128 random bits with no state, so any position of the stream
+	// can be computed directly, from any thread, in any order.
+	struct philox4x32
+	{
+		uint32_t key[2];
+
+		philox4x32(uint64_t seed = 0) { key[0] = (uint32_t)seed; key[1] = (uint32_t)(seed >> 32); }
+
+		void operator()(const uint32_t counter[4], uint32_t out[4]) const
+		{
+			uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+			uint32_t k0 = key[0], k1 = key[1];
+			for (int round = 0; round < 10; ++round) {
+				const uint64_t p0 = (uint64_t)0xD2511F53u * c0;
+				const uint64_t p1 = (uint64_t)0xCD9E8D57u * c2;
+				c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+				c1 = (uint32_t)p1;
+				c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+				c3 = (uint32_t)p0;
+				k0 += 0x9E3779B9u;
+				k1 += 0xBB67AE85u;
+			}
+			out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+		}
+
+		// The 128 random bits of item `i` of stream `stream`
+		void operator()(uint64_t i, uint64_t stream, uint32_t out[4]) const
+		{
+			const uint32_t counter[4] = { (uint32_t)i, (uint32_t)(i >> 32), (uint32_t)stream, (uint32_t)(stream >> 32) };
+			(*this)(counter, out);
+		}
+	};
+
+	namespace detail
+	{
+		// A float in [0, 1) from the top 24 bits
+		inline float unit_float(uint32_t bits) { return (float)(bits >> 8) * (1.0f / 16777216.0f); }
+
+		// A double in [0, 1) from the top 53 of 64 bits
+		inline double unit_double(uint32_t hi, uint32_t lo) { return (double)((((uint64_t)hi << 32) | lo) >> 11) * (1.0 / 9007199254740992.0); }
+	}
+
+	// Uniformly distributed floating point values in [lo, hi)
+	template<typename T = float>
+	struct uniform_distribution
+	{
+		typedef T result_type;
+		T lo, hi;
+		uniform_distribution(T lo = T(0), T hi = T(1)) : lo(lo), hi(hi) { }
+		T operator()(const uint32_t bits[4]) const { return lo + (hi - lo) * (T)detail::unit_double(bits[0], bits[1]); }
+	};
+
+	template<>
+	inline float uniform_distribution<float>::operator()(const uint32_t bits[4]) const { return lo + (hi - lo) * detail::unit_float(bits[0]); }
+
+	// Normally distributed floating point values, by the Box-Muller transform
+	template<typename T = float>
+	struct normal_distribution
+	{
+		typedef T result_type;
+		T mean, stddev;
+		normal_distribution(T mean = T(0), T stddev = T(1)) : mean(mean), stddev(stddev) { }
+		T operator()(const uint32_t bits[4]) const
+		{
+			// The first uniform is in (0, 1], so its logarithm is finite
+			const double u1 = 1.0 - detail::unit_double(bits[0], bits[1]);
+			const double u2 = detail::unit_double(bits[2], bits[3]);
+			return mean + stddev * (T)(std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2));
+		}
+	};
+
+	// Uniformly distributed integers in [lo, hi], inclusive. Ranges of up to 2^32 values use a multiply and shift
+	// (Lemire), larger ones a 64-bit remainder; both have a bias that is too small to measure in practice.
+	template<typename T = int32_t>
+	struct integer_distribution
+	{
+		typedef T result_type;
+		T lo, hi;
+		integer_distribution(T lo = T(0), T hi = T(1)) : lo(lo), hi(hi) { }
+		T operator()(const uint32_t bits[4]) const
+		{
+			const uint64_t range = (uint64_t)hi - (uint64_t)lo + 1;
+			if (range == 0) return (T)(((uint64_t)bits[0] << 32) | bits[1]);
+			if (range <= ((uint64_t)1 << 32)) return (T)((uint64_t)lo + (((uint64_t)bits[0] * range) >> 32));
+			return (T)((uint64_t)lo + ((((uint64_t)bits[0] << 32) | bits[1]) % range));
+		}
+	};
+
+	// Computes item `i` of a random array from the generator output for counter `i`
+	template<typename DistT>
+	struct random_func
+	{
+		typedef typename DistT::result_type result_type;
+		philox4x32 rng;
+		uint64_t stream;
+		DistT dist;
+
+		result_type operator()(size_t i) const
+		{
+			uint32_t bits[4];
+			rng(i, stream, bits);
+			return dist(bits);
+		}
+
+		void read(size_t first, size_t count, result_type* out) const
+		{
+			for (size_t i = 0; i < count; ++i) {
+				uint32_t bits[4];
+				rng(first + i, stream, bits);
+				out[i] = dist(bits);
+			}
+		}
+	};
+
+	// A computed array of random values in O(1) memory. Every item is a pure function of the seed, the stream, and its
+	// index, so items can be read in any order, in parallel, and with the same results on every run and platform
+	// (up to the precision of std::log and std::cos for the normal distribution). Different streams with the same seed
+	// are independent sequences.
+	template<typename DistT = uniform_distribution<float>>
+	struct random_array : public func_array<random_func<DistT>>
+	{
+		random_array(size_t size = 0, uint64_t seed = 0, DistT dist = DistT(), uint64_t stream = 0)
+			: func_array<random_func<DistT>>(random_func<DistT>{ philox4x32(seed), stream, dist }, size)
+		{ }
+
+		const DistT& distribution() const { return this->func().dist; }
+	};
+}
@@ -0,0 +1,356 @@
+/*
+	Ara 3d Array Library - Sparse Arrays
+	Copyright 2018, Ara 3D, Inc.
+	Usage licensed under terms of MIT Licenese
+*/
+#pragma once
+
+#include "array_concurrent.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace ara3d
+{
+	namespace detail
+	{
+		inline unsigned popcount64(uint64_t x)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return (unsigned)__builtin_popcountll(x);
+#else
+			x = x - ((x >> 1) & 0x5555555555555555ull);
+			x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+			x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+			return (unsigned)((x * 0x0101010101010101ull) >> 56);
+#endif
+		}
+
+		// Walks the union of two sorted index ranges in order, calling emit(index, a_pos, b_pos) for each index,
+		// where the position in an array that lacks the index is npos.
+		template<typename F>
+		void merge_indices(const uint32_t* a, size_t a_first, size_t a_last, const uint32_t* b, size_t b_first, size_t b_last, F emit)
+		{
+			const size_t npos = (size_t)-1;
+			while (a_first < a_last && b_first < b_last) {
+				if (a[a_first] < b[b_first]) { emit(a[a_first], a_first, npos); ++a_first; }
+				else if (b[b_first] < a[a_first]) { emit(b[b_first], npos, b_first); ++b_first; }
+				else { emit(a[a_first], a_first, b_first); ++a_first; ++b_first; }
+			}
+			for (; a_first < a_last; ++a_first) emit(a[a_first], a_first, npos);
+			for (; b_first < b_last; ++b_first) emit(b[b_first], npos, b_first);
+		}
+	}
+
+	// A logical array of `size()` elements where most elements have the same fill value. Only the other elements are stored,
+	// as a strictly ascending array of their indices and a parallel array of their values. Random access is a binary search
+	// of the indices, or a bitmap rank after `build_rank_index()`, which costs 1.5 bits per logical element.
+	template<typename T>
+	struct sparse_array
+	{
+		typedef T value_type;
+		static const size_t npos = (size_t)-1;
+
+		size_t _size;
+		array<uint32_t> _indices;
+		array<T> _values;
+		T _fill;
+		array<uint64_t> _bits;
+		array<uint32_t> _ranks;
+
+		sparse_array(size_t size = 0, T fill = T()) : _size(size), _fill(fill) { }
+
+		// The indices must be strictly ascending, and less than `size`
+		sparse_array(size_t size, array<uint32_t>&& indices, array<T>&& values, T fill = T())
+			: _size(size), _indices(static_cast<array<uint32_t>&&>(indices)), _values(static_cast<array<T>&&>(values)), _fill(fill)
+		{ }
+
+		size_t size() const { return _size; }
+		size_t nnz() const { return _indices.size(); }
+		const T& fill() const { return _fill; }
+		const_array_view<uint32_t> indices() const { return const_array_view<uint32_t>(_indices.begin(), _indices.size()); }
+		const_array_view<T> values() const { return const_array_view<T>(_values.begin(), _values.size()); }
+
+		// The stored values may be changed in place, but not which indices are stored
+		array_view<T> values() { return array_view<T>(_values.begin(), _values.size()); }
+
+		// Returns the position of logical element `i` in `values()`, or npos if it is not stored
+		size_t find(size_t i) const
+		{
+			if (_bits.size() != 0) {
+				const uint64_t word = _bits[i >> 6];
+				const uint64_t bit = (uint64_t)1 << (i & 63);
+				return word & bit ? _ranks[i >> 6] + detail::popcount64(word & (bit - 1)) : npos;
+			}
+			const uint32_t* p = std::lower_bound(_indices.begin(), _indices.end(), (uint32_t)i);
+			return p != _indices.end() && *p == i ? (size_t)(p - _indices.begin()) : npos;
+		}
+
+		bool contains(size_t i) const { return find(i) != npos; }
+
+		T operator[](size_t i) const
+		{
+			const size_t k = find(i);
+			return k == npos ? _fill : _values[k];
+		}
+
+		// Builds the bitmap and per-word ranks that make `find` constant time
+		void build_rank_index()
+		{
+			const size_t words = (_size + 63) / 64;
+			_bits = array<uint64_t>(words);
+			_ranks = array<uint32_t>(words);
+			parallel_for_blocks(words, [&](size_t first, size_t last) {
+				size_t k = std::lower_bound(_indices.begin(), _indices.end(), (uint32_t)(first * 64)) - _indices.begin();
+				for (size_t w = first; w < last; ++w) {
+					_ranks[w] = (uint32_t)k;
+					uint64_t bits = 0;
+					for (; k < _indices.size() && _indices[k] < (w + 1) * 64; ++k) bits |= (uint64_t)1 << (_indices[k] & 63);
+					_bits[w] = bits;
+				}
+			});
+		}
+
+		bool has_rank_index() const { return _bits.size() != 0; }
+
+		// Writes the stored elements into a dense array of at least `size()` elements, leaving the others unchanged
+		template<typename ViewT>
+		void scatter(ViewT&& dense) const
+		{
+			parallel_for_blocks(_indices.size(), [&](size_t first, size_t last) {
+				for (size_t k = first; k < last; ++k) dense[_indices[k]] = _values[k];
+			});
+		}
+
+		// Writes every logical element into a dense array of at least `size()` elements
+		template<typename ViewT>
+		void to_dense(ViewT&& dense) const
+		{
+			parallel_for_blocks(_size, [&](size_t first, size_t last) {
+				for (size_t i = first; i < last; ++i) dense[i] = _fill;
+			});
+			scatter(dense);
+		}
+
+		array<T> to_dense() const
+		{
+			array<T> r(_size);
+			to_dense(r);
+			return r;
+		}
+
+		// Sums the products of the stored elements with the matching elements of a dense array. The fill value is treated as zero.
+		template<typename ViewT>
+		T dot(const ViewT& dense) const
+		{
+			const size_t n = _indices.size();
+			const size_t parts = n < 65536 ? 1 : concurrency();
+			array<T> sums(parts);
+			parallel_partition(n, parts, [&](size_t p, size_t first, size_t last) {
+				T sum = T();
+				for (size_t k = first; k < last; ++k) sum += _values[k] * dense[_indices[k]];
+				sums[p] = sum;
+			});
+			T sum = T();
+			for (size_t p = 0; p < parts; ++p) sum += sums[p];
+			return sum;
+		}
+
+		// Stores the elements of a dense array that differ from `fill`
+		template<typename ViewT>
+		static sparse_array from_dense(const ViewT& dense, T fill = T())
+		{
+			const size_t n = dense.size();
+			const size_t parts = n < 65536 ? 1 : concurrency();
+			array<size_t> offsets(parts);
+			parallel_partition(n, parts, [&](size_t p, size_t first, size_t last) {
+				size_t count = 0;
+				for (size_t i = first; i < last; ++i) count += !(dense[i] == fill);
+				offsets[p] = count;
+			});
+			const size_t nnz = parallel_exclusive_scan<size_t>(offsets);
+			sparse_array r(n, array<uint32_t>(nnz), array<T>(nnz), fill);
+			parallel_partition(n, parts, [&](size_t p, size_t first, size_t last) {
+				size_t k = offsets[p];
+				for (size_t i = first; i < last; ++i)
+					if (!(dense[i] == fill)) { r._indices[k] = (uint32_t)i; r._values[k++] = dense[i]; }
+			});
+			return r;
+		}
+
+		// Stores index and value pairs given in any order. When an index is given more than once, the last value wins.
+		static sparse_array from_unsorted(size_t size, const_array_view<uint32_t> indices, const_array_view<T> values, T fill = T())
+		{
+			array<uint64_t> keys(indices.size());
+			parallel_for(keys.size(), [&](size_t i) { keys[i] = indices[i]; });
+			const array<uint32_t> order = sort_permutation(keys);
+			size_t nnz = 0;
+			for (size_t i = 0; i < order.size(); ++i) nnz += i + 1 == order.size() || keys[order[i]] != keys[order[i + 1]];
+			sparse_array r(size, array<uint32_t>(nnz), array<T>(nnz), fill);
+			for (size_t i = 0, k = 0; i < order.size(); ++i) {
+				if (i + 1 != order.size() && keys[order[i]] == keys[order[i + 1]]) continue;
+				r._indices[k] = indices[order[i]];
+				r._values[k++] = values[order[i]];
+			}
+			return r;
+		}
+	};
+
+	// Combines two sparse arrays of the same size into one that stores the union of their indices. Where both store
+	// an index the value is combine(a_value, b_value), otherwise the stored value is kept. The result takes the fill of `a`.
+	// The index space is split at evenly spaced indices of the larger array, and the parts are merged in parallel.
+	template<typename T, typename F>
+	sparse_array<T> merge(const sparse_array<T>& a, const sparse_array<T>& b, F combine)
+	{
+		const size_t npos = (size_t)-1;
+		const sparse_array<T>& larger = a.nnz() < b.nnz() ? b : a;
+		const size_t parts = larger.nnz() < 65536 ? 1 : concurrency();
+		array<size_t> a_split(parts + 1), b_split(parts + 1), offsets(parts);
+		for (size_t p = 0; p < parts; ++p) {
+			const uint32_t pivot = p == 0 ? 0 : larger._indices[larger.nnz() * p / parts];
+			a_split[p] = std::lower_bound(a._indices.begin(), a._indices.end(), pivot) - a._indices.begin();
+			b_split[p] = std::lower_bound(b._indices.begin(), b._indices.end(), pivot) - b._indices.begin();
+		}
+		a_split[parts] = a.nnz();
+		b_split[parts] = b.nnz();
+		parallel_for(parts, [&](size_t p) {
+			size_t count = 0;
+			detail::merge_indices(a._indices.begin(), a_split[p], a_split[p + 1], b._indices.begin(), b_split[p], b_split[p + 1],
+				[&](uint32_t, size_t, size_t) { ++count; });
+			offsets[p] = count;
+		}, 1);
+		const size_t nnz = parallel_exclusive_scan<size_t>(offsets);
+		sparse_array<T> r(a.size(), array<uint32_t>(nnz), array<T>(nnz), a.fill());
+		parallel_for(parts, [&](size_t p) {
+			size_t k = offsets[p];
+			detail::merge_indices(a._indices.begin(), a_split[p], a_split[p + 1], b._indices.begin(), b_split[p], b_split[p + 1],
+				[&](uint32_t i, size_t ka, size_t kb) {
+					r._indices[k] = i;
+					r._values[k++] = ka == npos ? b._values[kb] : kb == npos ? a._values[ka] : combine(a._values[ka], b._values[kb]);
+				});
+		}, 1);
+		return r;
+	}
+
+	// Overlays `b` on `a`: where both store an index, the value from `b` wins
+	template<typename T>
+	sparse_array<T> merge(const sparse_array<T>& a, const sparse_array<T>& b)
+	{
+		return merge(a, b, [](const T&, const T& y) { return y; });
+	}
+
+	// A directed graph in compressed sparse row form: the targets of the edges leaving vertex `v` are stored in
+	// `targets()[offsets()[v]] .. targets()[offsets()[v + 1] - 1]`, in the order the edges were given.
+	struct csr_graph
+	{
+		array<uint32_t> _offsets;
+		array<uint32_t> _targets;
+
+		csr_graph() { }
+
+		// Builds the graph from the edges (sources[i], targets[i]), by counting the edges of each vertex and scanning
+		// the counts in parallel. When `undirected` is set, each edge is also stored in the reverse direction.
+		csr_graph(size_t vertices, const_array_view<uint32_t> sources, const_array_view<uint32_t> targets, bool undirected = false)
+		{
+			const size_t m = sources.size();
+			array<uint32_t> from(undirected ? m * 2 : m), to(from.size());
+			parallel_for(m, [&](size_t i) {
+				from[i] = sources[i];
+				to[i] = targets[i];
+				if (undirected) { from[m + i] = targets[i]; to[m + i] = sources[i]; }
+			});
+			array<uint32_t> edges;
+			counting_sort_by_key(from, vertices, _offsets, edges);
+			_targets = array<uint32_t>(edges.size());
+			parallel_for(edges.size(), [&](size_t k) { _targets[k] = to[edges[k]]; });
+		}
+
+		size_t vertex_count() const { return _offsets.size() == 0 ? 0 : _offsets.size() - 1; }
+		size_t edge_count() const { return _targets.size(); }
+		size_t degree(uint32_t v) const { return _offsets[v + 1] - _offsets[v]; }
+
+		const_array_view<uint32_t> offsets() const { return const_array_view<uint32_t>(_offsets.begin(), _offsets.size()); }
+		const_array_view<uint32_t> targets() const { return const_array_view<uint32_t>(_targets.begin(), _targets.size()); }
+
+		const_array_slice<const_array_view<uint32_t>> neighbors(uint32_t v) const
+		{
+			return const_array_slice<const_array_view<uint32_t>>(_targets.begin() + _offsets[v], degree(v));
+		}
+	};
+
+	// Returns the number of edges on the shortest path from `source` to each vertex, or UINT32_MAX for vertices that
+	// cannot be reached. The search expands one level at a time, with the frontier split across threads; each vertex is
+	// claimed by an atomic compare and swap, and threads append to the next frontier a batch at a time.
+	inline array<uint32_t> breadth_first_levels(const csr_graph& graph, uint32_t source)
+	{
+		const size_t n = graph.vertex_count();
+		array<uint32_t> levels(n);
+		parallel_for(n, [&](size_t v) { levels[v] = UINT32_MAX; });
+		if (source >= n) return levels;
+		const atomic_array_view<uint32_t> claims(levels);
+		array<uint32_t> frontier(n), next(n);
+		levels[source] = 0;
+		frontier[0] = source;
+		size_t frontier_size = 1;
+		for (uint32_t level = 1; frontier_size != 0; ++level) {
+			std::atomic<size_t> next_size(0);
+			parallel_for_blocks(frontier_size, [&](size_t first, size_t last) {
+				uint32_t batch[256];
+				size_t count = 0;
+				for (size_t i = first; i < last; ++i) {
+					for (uint32_t w : graph.neighbors(frontier[i])) {
+						uint32_t expected = UINT32_MAX;
+						if (claims.load(w) != UINT32_MAX || !claims.compare_exchange(w, expected, level)) continue;
+						if (count == 256) {
+							std::copy(batch, batch + count, next.begin() + next_size.fetch_add(count));
+							count = 0;
+						}
+						batch[count++] = w;
+					}
+				}
+				std::copy(batch, batch + count, next.begin() + next_size.fetch_add(count));
+			}, 256);
+			frontier_size = next_size.load();
+			std::swap(frontier, next);
+		}
+		return levels;
+	}
+
+	// Labels the connected components of the graph, treating every edge as undirected. Each vertex gets the id of its
+	// component in `labels`, numbered in order of each component's lowest vertex, and the number of components is returned.
+	// Edges are merged in parallel with a lock-free union-find, which always hooks the larger root under the smaller one.
+	inline size_t connected_components(const csr_graph& graph, array<uint32_t>& labels)
+	{
+		const size_t n = graph.vertex_count();
+		array<uint32_t> parents(n);
+		parallel_for(n, [&](size_t v) { parents[v] = (uint32_t)v; });
+		const atomic_array_view<uint32_t> parent(parents);
+		auto find = [&](uint32_t x) {
+			for (;;) {
+				uint32_t p = parent.load(x);
+				if (p == x) return x;
+				const uint32_t gp = parent.load(p);
+				// Path halving: point x at its grandparent, which is still one of its ancestors
+				if (gp != p) parent.compare_exchange(x, p, gp);
+				x = gp;
+			}
+		};
+		parallel_for_blocks(n, [&](size_t first, size_t last) {
+			for (size_t u = first; u < last; ++u) {
+				for (uint32_t v : graph.neighbors((uint32_t)u)) {
+					for (;;) {
+						uint32_t a = find((uint32_t)u), b = find(v);
+						if (a == b) break;
+						if (a < b) std::swap(a, b);
+						if (parent.compare_exchange(a, a, b)) break;
+					}
+				}
+			}
+		}, 1024);
+		labels = array<uint32_t>(n);
+		array<uint32_t> ids(n);
+		parallel_for(n, [&](size_t v) { labels[v] = find((uint32_t)v); ids[v] = labels[v] == v; });
+		const size_t count = parallel_exclusive_scan<uint32_t>(ids);
+		parallel_for(n, [&](size_t v) { labels[v] = ids[labels[v]]; });
+		return count;
+	}
+}
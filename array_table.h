@@ -0,0 +1,839 @@
+/*
+	Ara 3d Array Library - Columnar Data
+	Copyright 2018, Ara 3D, Inc.
+	Usage licensed under terms of MIT Licenese
+*/
+#pragma once
+
+#include "array_concurrent.h"
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace ara3d
+{
+	// The distinct values of a key column and the group that each row belongs to
+	template<typename K>
+	struct key_groups
+	{
+		array<K> keys;              // The key of each group
+		array<uint32_t> row_groups; // The group of each row
+		array<uint32_t> counts;     // The number of rows in each group
+
+		size_t size() const { return keys.size(); }
+	};
+
+	namespace detail
+	{
+		inline uint64_t mix_hash(uint64_t h)
+		{
+			h ^= h >> 33; h *= 0xff51afd7ed558ccdull;
+			h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ull;
+			return h ^ (h >> 33);
+		}
+
+		template<typename ArrayT, typename K>
+		void group_rows_by_range(const ArrayT& keys, K lo, size_t range, key_groups<K>& r)
+		{
+			const size_t n = keys.size();
+			array<uint32_t> bins(n);
+			parallel_for(n, [&](size_t i) { bins[i] = (uint32_t)((uint64_t)keys[i] - (uint64_t)lo); });
+			array<uint32_t> counts = histogram(bins, range);
+			// Number the keys that occur, in ascending order
+			array<uint32_t> ids(range);
+			parallel_for(range, [&](size_t k) { ids[k] = counts[k] ? 1 : 0; });
+			const size_t groups = parallel_exclusive_scan<uint32_t>(ids);
+			r.keys = array<K>(groups);
+			r.counts = array<uint32_t>(groups);
+			parallel_for(range, [&](size_t k) {
+				if (counts[k]) { r.keys[ids[k]] = (K)((uint64_t)lo + k); r.counts[ids[k]] = counts[k]; }
+			});
+			r.row_groups = array<uint32_t>(n);
+			parallel_for(n, [&](size_t i) { r.row_groups[i] = ids[bins[i]]; });
+		}
+
+		template<typename ArrayT, typename K>
+		void group_rows_by_hash(const ArrayT& keys, key_groups<K>& r)
+		{
+			const size_t n = keys.size();
+			// Split the rows into partitions by the top bits of the hash, then number the keys of each partition independently
+			size_t partition_bits = 0;
+			while (((size_t)1 << partition_bits) < concurrency() * 4 && ((size_t)1 << partition_bits) * 65536 < n) ++partition_bits;
+			const size_t partitions = (size_t)1 << partition_bits;
+			array<uint64_t> hashes(n);
+			array<uint32_t> row_partitions(n);
+			parallel_for(n, [&](size_t i) {
+				hashes[i] = mix_hash((uint64_t)std::hash<K>()(keys[i]));
+				row_partitions[i] = partition_bits ? (uint32_t)(hashes[i] >> (64 - partition_bits)) : 0;
+			});
+			array<uint32_t> offsets, rows;
+			counting_sort_by_key(row_partitions, partitions, offsets, rows);
+
+			array<uint32_t> local_groups(n), first_rows(n), group_counts(partitions + 1);
+			parallel_for(partitions, [&](size_t p) {
+				const uint32_t first = offsets[p], last = offsets[p + 1];
+				size_t capacity = 16;
+				while (capacity < (size_t)(last - first) * 2) capacity <<= 1;
+				// Open addressing table of local group ids, where UINT32_MAX marks an empty slot
+				array<uint32_t> table(capacity);
+				for (size_t s = 0; s < capacity; ++s) table[s] = UINT32_MAX;
+				uint32_t count = 0;
+				for (uint32_t i = first; i < last; ++i) {
+					const uint32_t row = rows[i];
+					for (size_t s = hashes[row] & (capacity - 1); ; s = (s + 1) & (capacity - 1)) {
+						const uint32_t g = table[s];
+						if (g == UINT32_MAX) {
+							table[s] = count;
+							first_rows[first + count] = row;
+							local_groups[row] = count++;
+							break;
+						}
+						if (keys[first_rows[first + g]] == keys[row]) { local_groups[row] = g; break; }
+					}
+				}
+				group_counts[p] = count;
+			}, 1);
+			group_counts[partitions] = 0;
+			const size_t groups = parallel_exclusive_scan<uint32_t>(group_counts);
+			r.keys = array<K>(groups);
+			parallel_for(partitions, [&](size_t p) {
+				for (uint32_t g = 0; g < group_counts[p + 1] - group_counts[p]; ++g) r.keys[group_counts[p] + g] = keys[first_rows[offsets[p] + g]];
+			}, 1);
+			r.row_groups = array<uint32_t>(n);
+			parallel_for(n, [&](size_t i) { r.row_groups[i] = group_counts[row_partitions[i]] + local_groups[i]; });
+			r.counts = histogram(r.row_groups, groups);
+		}
+
+		template<typename ArrayT, typename K>
+		void group_rows(const ArrayT& keys, key_groups<K>& r, std::true_type)
+		{
+			const size_t n = keys.size();
+			if (n == 0) { group_rows_by_hash(keys, r); return; }
+			const size_t parts = n < 65536 ? 1 : concurrency();
+			array<K> lo(parts), hi(parts);
+			parallel_partition(n, parts, [&](size_t p, size_t first, size_t last) {
+				lo[p] = hi[p] = keys[first < n ? first : 0];
+				for (size_t i = first; i < last; ++i) { if (keys[i] < lo[p]) lo[p] = keys[i]; if (hi[p] < keys[i]) hi[p] = keys[i]; }
+			});
+			for (size_t p = 1; p < parts; ++p) { if (lo[p] < lo[0]) lo[0] = lo[p]; if (hi[0] < hi[p]) hi[0] = hi[p]; }
+			// Keys in a small range (such as levels, materials, or categories) are counted directly, as a counting sort
+			const uint64_t range = (uint64_t)hi[0] - (uint64_t)lo[0] + 1;
+			if (range != 0 && range <= 2 * (uint64_t)n + 65536) group_rows_by_range(keys, lo[0], (size_t)range, r);
+			else group_rows_by_hash(keys, r);
+		}
+
+		template<typename ArrayT, typename K>
+		void group_rows(const ArrayT& keys, key_groups<K>& r, std::false_type)
+		{
+			group_rows_by_hash(keys, r);
+		}
+
+		struct sum_op
+		{
+			template<typename V> static V identity() { return V(); }
+			template<typename V> static V combine(V a, V b) { return a + b; }
+			template<typename V> static void atomic(const atomic_array_view<V>& r, size_t g, V v) { r.fetch_add(g, v); }
+		};
+
+		struct min_op
+		{
+			template<typename V> static V identity() { return std::numeric_limits<V>::has_infinity ? std::numeric_limits<V>::infinity() : std::numeric_limits<V>::max(); }
+			template<typename V> static V combine(V a, V b) { return b < a ? b : a; }
+			template<typename V> static void atomic(const atomic_array_view<V>& r, size_t g, V v) { r.fetch_min(g, v); }
+		};
+
+		struct max_op
+		{
+			template<typename V> static V identity() { return std::numeric_limits<V>::has_infinity ? -std::numeric_limits<V>::infinity() : std::numeric_limits<V>::lowest(); }
+			template<typename V> static V combine(V a, V b) { return a < b ? b : a; }
+			template<typename V> static void atomic(const atomic_array_view<V>& r, size_t g, V v) { r.fetch_max(g, v); }
+		};
+
+		// Aggregates the values of each group into accumulators of type A. With few groups every thread accumulates privately
+		// and the results are merged; with many groups, collisions are rare and the threads update shared results with atomics.
+		template<typename OpT, typename A, typename ArrayT>
+		array<A> group_aggregate(const array<uint32_t>& row_groups, size_t groups, const ArrayT& values)
+		{
+			const size_t n = values.size();
+			const size_t parts = n < 65536 ? 1 : concurrency();
+			array<A> r(groups);
+			if (parts > 1 && groups * parts > n && groups > 4096) {
+				parallel_for(groups, [&](size_t g) { r[g] = OpT::template identity<A>(); });
+				atomic_array_view<A> results(r);
+				parallel_for(n, [&](size_t i) { OpT::atomic(results, row_groups[i], (A)values[i]); });
+				return r;
+			}
+			array<A> partial(parts * groups);
+			parallel_partition(n, parts, [&](size_t p, size_t first, size_t last) {
+				A* acc = partial.begin() + p * groups;
+				for (size_t g = 0; g < groups; ++g) acc[g] = OpT::template identity<A>();
+				for (size_t i = first; i < last; ++i) acc[row_groups[i]] = OpT::combine(acc[row_groups[i]], (A)values[i]);
+			});
+			parallel_for(groups, [&](size_t g) {
+				A v = partial[g];
+				for (size_t p = 1; p < parts; ++p) v = OpT::combine(v, partial[p * groups + g]);
+				r[g] = v;
+			});
+			return r;
+		}
+	}
+
+	// Finds the distinct keys of a column and assigns each row to a group, in parallel. Integer keys that span a small range
+	// are counted directly and the groups are in ascending key order. Other keys are hash partitioned, and each partition is
+	// grouped with its own hash table, so groups appear in an unspecified order. Keys need `==` and `std::hash`.
+	// The keys can be any array: stored, strided, or computed.
+	template<typename ArrayT, typename K = typename ArrayT::value_type>
+	key_groups<K> group_by(const ArrayT& keys)
+	{
+		key_groups<K> r;
+		detail::group_rows(keys, r, std::is_integral<K>());
+		return r;
+	}
+
+	// The sum of the values of each group. The values are any array with one item per row of the grouped key column.
+	template<typename K, typename ArrayT, typename V = typename ArrayT::value_type>
+	array<V> group_sum(const key_groups<K>& groups, const ArrayT& values)
+	{
+		return detail::group_aggregate<detail::sum_op, V>(groups.row_groups, groups.size(), values);
+	}
+
+	// The smallest value of each group
+	template<typename K, typename ArrayT, typename V = typename ArrayT::value_type>
+	array<V> group_min(const key_groups<K>& groups, const ArrayT& values)
+	{
+		return detail::group_aggregate<detail::min_op, V>(groups.row_groups, groups.size(), values);
+	}
+
+	// The largest value of each group
+	template<typename K, typename ArrayT, typename V = typename ArrayT::value_type>
+	array<V> group_max(const key_groups<K>& groups, const ArrayT& values)
+	{
+		return detail::group_aggregate<detail::max_op, V>(groups.row_groups, groups.size(), values);
+	}
+
+	// The mean value of each group, computed in double precision
+	template<typename K, typename ArrayT>
+	array<double> group_mean(const key_groups<K>& groups, const ArrayT& values)
+	{
+		array<double> r = detail::group_aggregate<detail::sum_op, double>(groups.row_groups, groups.size(), values);
+		parallel_for(r.size(), [&](size_t g) { r[g] /= groups.counts[g]; });
+		return r;
+	}
+
+	// The number of rows in each group
+	template<typename K>
+	const_array_view<uint32_t> group_count(const key_groups<K>& groups)
+	{
+		return groups.counts;
+	}
+
+	// The element type of a table column. Types other than the built-in numbers are stored as plain bytes of a fixed size.
+	enum class column_type : uint32_t
+	{
+		bytes, int8, uint8, int16, uint16, int32, uint32, int64, uint64, float32, float64
+	};
+
+	template<typename T> struct column_type_of { static const column_type value = column_type::bytes; };
+	template<> struct column_type_of<int8_t> { static const column_type value = column_type::int8; };
+	template<> struct column_type_of<uint8_t> { static const column_type value = column_type::uint8; };
+	template<> struct column_type_of<int16_t> { static const column_type value = column_type::int16; };
+	template<> struct column_type_of<uint16_t> { static const column_type value = column_type::uint16; };
+	template<> struct column_type_of<int32_t> { static const column_type value = column_type::int32; };
+	template<> struct column_type_of<uint32_t> { static const column_type value = column_type::uint32; };
+	template<> struct column_type_of<int64_t> { static const column_type value = column_type::int64; };
+	template<> struct column_type_of<uint64_t> { static const column_type value = column_type::uint64; };
+	template<> struct column_type_of<float> { static const column_type value = column_type::float32; };
+	template<> struct column_type_of<double> { static const column_type value = column_type::float64; };
+
+	// A named, typed column of a table. The data is either owned by the table (shared between tables made from it by
+	// projection or slicing) or borrowed from memory that must outlive the table, such as a memory mapped file.
+	struct table_column
+	{
+		std::string name;
+		column_type type;
+		uint32_t element_size;
+		const unsigned char* data;
+		std::shared_ptr<void> owner;
+	};
+
+	// A set of named columns of equal length, such as the properties of a set of elements. Columns are contiguous arrays
+	// of trivially copyable items, so scans and filters are ordinary array algorithms. Tables can be written to a flat
+	// byte layout and read back from memory without copying the columns. Like the other containers, tables are moved rather
+	// than copied; `select` and `slice` make new tables that share the columns.
+	struct table
+	{
+		dynamic_array<table_column> _columns;
+		size_t _rows;
+
+		table() : _rows(0) { }
+
+		size_t row_count() const { return _rows; }
+		size_t column_count() const { return _columns.size(); }
+		const table_column& column_at(size_t i) const { return _columns[i]; }
+
+		// Returns the index of the named column, or -1 if there is none
+		ptrdiff_t column_index(const std::string& name) const
+		{
+			for (size_t i = 0; i < _columns.size(); ++i)
+				if (_columns[i].name == name) return (ptrdiff_t)i;
+			return -1;
+		}
+
+		// Adds a column that takes ownership of an array. Fails if the name is taken or the length differs from the other columns.
+		template<typename T>
+		bool add_column(const std::string& name, array<T>&& values)
+		{
+			std::shared_ptr<array<T>> owner(new array<T>(static_cast<array<T>&&>(values)));
+			return add(name, column_type_of<T>::value, sizeof(T), (const unsigned char*)owner->begin(), owner->size(), owner);
+		}
+
+		// Adds a column that refers to memory owned elsewhere
+		template<typename T>
+		bool add_column(const std::string& name, const_array_view<T> values)
+		{
+			return add(name, column_type_of<T>::value, sizeof(T), (const unsigned char*)values.begin(), values.size(), std::shared_ptr<void>());
+		}
+
+		// Returns the named column, or an empty view if there is no such column or its items are not of type T
+		template<typename T>
+		const_array_view<T> column(const std::string& name) const
+		{
+			const ptrdiff_t i = column_index(name);
+			if (i < 0 || _columns[i].type != column_type_of<T>::value || _columns[i].element_size != sizeof(T)) return const_array_view<T>();
+			return const_array_view<T>((const T*)_columns[i].data, _rows);
+		}
+
+		// Returns `count` rows of the named column starting at row `first`
+		template<typename T>
+		const_array_slice<const_array_view<T>> rows(const std::string& name, size_t first, size_t count) const
+		{
+			const_array_view<T> c = column<T>(name);
+			if (first > c.size()) first = c.size();
+			return const_array_slice<const_array_view<T>>(c.begin() + first, first + count <= c.size() ? count : c.size() - first);
+		}
+
+		// A table with only the named columns, in the given order, sharing their data with this one. Unknown names are skipped.
+		table select(const std::vector<std::string>& names) const
+		{
+			table r;
+			for (size_t n = 0; n < names.size(); ++n) {
+				const ptrdiff_t i = column_index(names[n]);
+				if (i >= 0) r.add_existing(_columns[i], 0, _rows);
+			}
+			return r;
+		}
+
+		// A table with `count` rows of every column starting at row `first`, sharing their data with this one
+		table slice(size_t first, size_t count) const
+		{
+			table r;
+			if (first > _rows) first = _rows;
+			if (count > _rows - first) count = _rows - first;
+			for (size_t i = 0; i < _columns.size(); ++i) r.add_existing(_columns[i], first, count);
+			r._rows = count;
+			return r;
+		}
+
+		// The number of bytes written by `save`
+		size_t saved_size() const
+		{
+			size_t size = header_size + _columns.size() * directory_entry_size;
+			for (size_t i = 0; i < _columns.size(); ++i) size += _columns[i].name.size();
+			for (size_t i = 0; i < _columns.size(); ++i) size = align(size) + _columns[i].element_size * _rows;
+			return size;
+		}
+
+		// Writes the table into `out`, which must hold `saved_size()` bytes, and returns false if it does not. The layout is a
+		// header, a directory of columns, the column names, and then each column's items at an offset aligned to 64 bytes,
+		// in native byte order. Padding bytes are zero.
+		bool save(array_view<unsigned char> out) const
+		{
+			if (out.size() < saved_size()) return false;
+			unsigned char* base = out.begin();
+			const uint64_t header[3] = { magic, (uint64_t)_rows, (uint64_t)_columns.size() };
+			std::memcpy(base, header, header_size);
+			size_t names = header_size + _columns.size() * directory_entry_size;
+			size_t data = names;
+			for (size_t i = 0; i < _columns.size(); ++i) data += _columns[i].name.size();
+			for (size_t i = 0; i < _columns.size(); ++i)
+			{
+				const table_column& c = _columns[i];
+				// Zero the padding before the column, so the same table always saves to the same bytes
+				std::memset(base + data, 0, align(data) - data);
+				data = align(data);
+				const uint64_t entry[4] = { (uint64_t)c.type | (uint64_t)c.element_size << 32, (uint64_t)names, (uint64_t)c.name.size(), (uint64_t)data };
+				std::memcpy(base + header_size + i * directory_entry_size, entry, directory_entry_size);
+				std::memcpy(base + names, c.name.data(), c.name.size());
+				names += c.name.size();
+				const size_t bytes = c.element_size * _rows;
+				parallel_for_blocks(bytes, [&](size_t first, size_t last) { std::memcpy(base + data + first, c.data + first, last - first); }, 1 << 20);
+				data += bytes;
+			}
+			return true;
+		}
+
+		// Writes the table into a new buffer
+		buffer save() const
+		{
+			buffer r(saved_size());
+			save(r);
+			return r;
+		}
+
+		// Reads a table written by `save` without copying: the columns refer to `bytes`, which must outlive the table. 
+		// Returns false if the bytes are not a valid table, or are not aligned well enough to access the columns in place.
+		static bool load(const_array_view<unsigned char> bytes, table& out)
+		{
+			out = table();
+			uint64_t header[3];
+			if (bytes.size() < header_size) return false;
+			std::memcpy(header, bytes.begin(), header_size);
+			if (header[0] != magic || (bytes.size() - header_size) / directory_entry_size < header[2]) return false;
+			out._rows = (size_t)header[1];
+			for (size_t i = 0; i < header[2]; ++i)
+			{
+				uint64_t entry[4];
+				std::memcpy(entry, bytes.begin() + header_size + i * directory_entry_size, directory_entry_size);
+				const uint32_t element_size = (uint32_t)(entry[0] >> 32);
+				const size_t alignment = element_size % 8 == 0 ? 8 : element_size % 4 == 0 ? 4 : element_size % 2 == 0 ? 2 : 1;
+				if (entry[1] > bytes.size() || entry[2] > bytes.size() - entry[1] || entry[3] > bytes.size()
+					|| (bytes.size() - entry[3]) / (element_size ? element_size : 1) < out._rows
+					|| ((uintptr_t)(bytes.begin() + entry[3])) % alignment != 0) {
+					out = table();
+					return false;
+				}
+				table_column c;
+				c.name.assign((const char*)bytes.begin() + entry[1], (size_t)entry[2]);
+				c.type = (column_type)(uint32_t)entry[0];
+				c.element_size = element_size;
+				c.data = bytes.begin() + entry[3];
+				out._columns.push_back(static_cast<table_column&&>(c));
+			}
+			return true;
+		}
+
+	private:
+		static const uint64_t magic = 0x31304c4254415241ull; // "ARATBL01"
+		static const size_t header_size = 24;
+		static const size_t directory_entry_size = 32;
+
+		static size_t align(size_t offset) { return (offset + 63) & ~(size_t)63; }
+
+		bool add(const std::string& name, column_type type, size_t element_size, const unsigned char* data, size_t size, std::shared_ptr<void> owner)
+		{
+			if (column_index(name) >= 0 || (!_columns.empty() && size != _rows)) return false;
+			table_column c;
+			c.name = name;
+			c.type = type;
+			c.element_size = (uint32_t)element_size;
+			c.data = data;
+			c.owner = owner;
+			_columns.push_back(static_cast<table_column&&>(c));
+			_rows = size;
+			return true;
+		}
+
+		void add_existing(const table_column& c, size_t first, size_t count)
+		{
+			table_column r(c);
+			r.data = c.data + first * c.element_size;
+			_columns.push_back(static_cast<table_column&&>(r));
+			_rows = count;
+		}
+	};
+
+	// Compares the characters of two string views
+	inline bool operator==(const const_array_view<char>& a, const const_array_view<char>& b)
+	{
+		return a.size() == b.size() && (a.size() == 0 || std::memcmp(a.begin(), b.begin(), a.size()) == 0);
+	}
+
+	inline bool operator!=(const const_array_view<char>& a, const const_array_view<char>& b)
+	{
+		return !(a == b);
+	}
+
+	// A view of the characters of a null terminated string
+	inline const_array_view<char> string_view(const char* s)
+	{
+		return const_array_view<char>(s, std::strlen(s));
+	}
+
+	inline const_array_view<char> string_view(const std::string& s)
+	{
+		return const_array_view<char>(s.data(), s.size());
+	}
+
+	namespace detail
+	{
+		// FNV-1a over the bytes, finished with a mixing step so that all bits are usable
+		inline uint64_t hash_bytes(const char* data, size_t size)
+		{
+			uint64_t h = 0xcbf29ce484222325ull;
+			for (size_t i = 0; i < size; ++i) h = (h ^ (unsigned char)data[i]) * 0x100000001b3ull;
+			return mix_hash(h);
+		}
+	}
+}
+
+namespace std
+{
+	template<>
+	struct hash<ara3d::const_array_view<char>>
+	{
+		size_t operator()(const ara3d::const_array_view<char>& s) const { return (size_t)ara3d::detail::hash_bytes(s.begin(), s.size()); }
+	};
+}
+
+namespace ara3d
+{
+	// Returns the rows [0, n) for which `pred(row)` holds, in ascending order. Each block of rows is counted and then
+	// written in parallel, so the output is allocated once at its exact size.
+	template<typename PredF>
+	array<uint32_t> select_rows(size_t n, PredF pred)
+	{
+		const size_t block = 16384;
+		const size_t blocks = (n + block - 1) / block;
+		array<uint32_t> offsets(blocks + 1);
+		parallel_for(blocks, [&](size_t b) {
+			uint32_t count = 0;
+			for (size_t i = b * block, end = std::min(n, (b + 1) * block); i < end; ++i) count += pred(i) ? 1 : 0;
+			offsets[b] = count;
+		}, 1);
+		offsets[blocks] = 0;
+		array<uint32_t> r(parallel_exclusive_scan<uint32_t>(offsets));
+		parallel_for(blocks, [&](size_t b) {
+			uint32_t* out = r.begin() + offsets[b];
+			for (size_t i = b * block, end = std::min(n, (b + 1) * block); i < end; ++i)
+				if (pred(i)) *out++ = (uint32_t)i;
+		}, 1);
+		return r;
+	}
+
+	// Returns the rows whose value equals `value`. With SSE2, four codes are compared at a time and blocks without a match are skipped.
+	inline array<uint32_t> select_equal(const_array_view<uint32_t> values, uint32_t value)
+	{
+#if defined(__SSE2__) || defined(_M_X64)
+		const size_t n = values.size();
+		const size_t block = 16384;
+		const size_t blocks = (n + block - 1) / block;
+		array<uint32_t> offsets(blocks + 1);
+		const __m128i needle = _mm_set1_epi32((int)value);
+		// Returns a 4-bit mask of the matching items among values[i] .. values[i + 3]
+		auto match = [&](size_t i) { return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(values.begin() + i)), needle))); };
+		parallel_for(blocks, [&](size_t b) {
+			const size_t first = b * block, last = std::min(n, first + block);
+			uint32_t count = 0;
+			size_t i = first;
+			for (; i + 4 <= last; i += 4) { const int m = match(i); count += (m & 1) + (m >> 1 & 1) + (m >> 2 & 1) + (m >> 3 & 1); }
+			for (; i < last; ++i) count += values[i] == value ? 1 : 0;
+			offsets[b] = count;
+		}, 1);
+		offsets[blocks] = 0;
+		array<uint32_t> r(parallel_exclusive_scan<uint32_t>(offsets));
+		parallel_for(blocks, [&](size_t b) {
+			const size_t first = b * block, last = std::min(n, first + block);
+			uint32_t* out = r.begin() + offsets[b];
+			size_t i = first;
+			for (; i + 4 <= last; i += 4)
+				if (const int m = match(i))
+					for (int j = 0; j < 4; ++j)
+						if (m >> j & 1) *out++ = (uint32_t)(i + j);
+			for (; i < last; ++i)
+				if (values[i] == value) *out++ = (uint32_t)i;
+		}, 1);
+		return r;
+#else
+		return select_rows(values.size(), [&](size_t i) { return values[i] == value; });
+#endif
+	}
+
+	// A column of strings stored back to back in one buffer, with string `i` at `chars[offsets[i]] .. chars[offsets[i + 1] - 1]`.
+	// This replaces one heap allocation per string with two arrays for the whole column. The total length is limited to 4 GB.
+	struct string_column
+	{
+		buffer _chars;
+		array<uint32_t> _offsets;
+
+		string_column() : _offsets(1) { _offsets[0] = 0; }
+		string_column(buffer&& chars, array<uint32_t>&& offsets) : _chars(static_cast<buffer&&>(chars)), _offsets(static_cast<array<uint32_t>&&>(offsets)) { }
+
+		size_t size() const { return _offsets.size() - 1; }
+		bool empty() const { return size() == 0; }
+		const_array_view<char> operator[](size_t i) const { return const_array_view<char>((const char*)_chars.begin() + _offsets[i], _offsets[i + 1] - _offsets[i]); }
+		const buffer& chars() const { return _chars; }
+		const array<uint32_t>& offsets() const { return _offsets; }
+
+		// Returns the rows holding a string equal to `value`
+		array<uint32_t> select_equal(const_array_view<char> value) const
+		{
+			return select_rows(size(), [&](size_t i) { return (*this)[i] == value; });
+		}
+	};
+
+	// Builds a string_column by appending strings, growing its buffers without copying the strings into separate allocations
+	struct string_column_builder
+	{
+		dynamic_array<unsigned char> _chars;
+		dynamic_array<uint32_t> _offsets;
+
+		string_column_builder() { _offsets.push_back(0); }
+
+		size_t size() const { return _offsets.size() - 1; }
+		void reserve(size_t strings, size_t chars) { _offsets.reserve(strings + 1); _chars.reserve(chars); }
+
+		void push_back(const_array_view<char> s)
+		{
+			_chars.append((const unsigned char*)s.begin(), s.size());
+			_offsets.push_back((uint32_t)_chars.size());
+		}
+
+		void push_back(const std::string& s) { push_back(string_view(s)); }
+
+		// Transfers the strings to a column and leaves the builder empty
+		string_column finish()
+		{
+			string_column r(_chars.finish(), _offsets.finish());
+			_offsets.push_back(0);
+			return r;
+		}
+	};
+
+	// A dictionary encoded string column: the distinct strings are stored once in `dictionary`, and each row holds the
+	// 32-bit code of its string. Columns of names, categories, and types with few distinct values shrink to about four
+	// bytes per row, and equality filters compare integer codes instead of strings.
+	struct dictionary_column
+	{
+		string_column _dictionary;
+		array<uint32_t> _codes;
+		array<uint32_t> _index; // An open addressing hash table of codes, at most half full, for finding a string's code
+
+		size_t size() const { return _codes.size(); }
+		bool empty() const { return size() == 0; }
+		const_array_view<char> operator[](size_t i) const { return _dictionary[_codes[i]]; }
+		const string_column& dictionary() const { return _dictionary; }
+		const array<uint32_t>& codes() const { return _codes; }
+
+		// Returns the code of a string, or UINT32_MAX if it does not occur in the column
+		uint32_t code_of(const_array_view<char> value) const
+		{
+			if (_index.size() == 0) return UINT32_MAX;
+			const size_t mask = _index.size() - 1;
+			for (size_t slot = detail::hash_bytes(value.begin(), value.size()) & mask; ; slot = (slot + 1) & mask) {
+				const uint32_t code = _index[slot];
+				if (code == UINT32_MAX) return UINT32_MAX;
+				if (_dictionary[code] == value) return code;
+			}
+		}
+
+		// Returns the rows holding a string equal to `value`, by comparing codes
+		array<uint32_t> select_equal(const_array_view<char> value) const
+		{
+			const uint32_t code = code_of(value);
+			if (code == UINT32_MAX) return array<uint32_t>();
+			return ara3d::select_equal(_codes, code);
+		}
+
+		// Encodes a string column, finding the distinct strings in parallel with `group_by`
+		static dictionary_column encode(const string_column& strings)
+		{
+			array<const_array_view<char>> views(strings.size());
+			parallel_for(strings.size(), [&](size_t i) { views[i] = strings[i]; });
+			key_groups<const_array_view<char>> groups = group_by(views);
+			string_column_builder builder;
+			for (size_t g = 0; g < groups.size(); ++g) builder.push_back(groups.keys[g]);
+			dictionary_column r;
+			r._dictionary = builder.finish();
+			r._codes = static_cast<array<uint32_t>&&>(groups.row_groups);
+			r.build_index();
+			return r;
+		}
+
+		// Expands the column back to a plain string column
+		string_column decode() const
+		{
+			array<uint32_t> offsets(size() + 1);
+			parallel_for(size(), [&](size_t i) { offsets[i] = (uint32_t)(*this)[i].size(); });
+			offsets[size()] = 0;
+			buffer chars(parallel_exclusive_scan<uint32_t>(offsets));
+			parallel_for(size(), [&](size_t i) {
+				const_array_view<char> s = (*this)[i];
+				if (s.size()) std::memcpy(chars.begin() + offsets[i], s.begin(), s.size());
+			});
+			return string_column(static_cast<buffer&&>(chars), static_cast<array<uint32_t>&&>(offsets));
+		}
+
+	private:
+		void build_index()
+		{
+			size_t slots = 16;
+			while (slots < _dictionary.size() * 2) slots *= 2;
+			_index = array<uint32_t>(slots);
+			for (size_t s = 0; s < slots; ++s) _index[s] = UINT32_MAX;
+			for (size_t c = 0; c < _dictionary.size(); ++c) {
+				const const_array_view<char> value = _dictionary[c];
+				size_t slot = detail::hash_bytes(value.begin(), value.size()) & (slots - 1);
+				while (_index[slot] != UINT32_MAX) slot = (slot + 1) & (slots - 1);
+				_index[slot] = (uint32_t)c;
+			}
+		}
+	};
+
+	// Deduplicates strings, storing each distinct string once in large arena blocks, and gives each a stable 32-bit id.
+	// Views returned by the pool stay valid for its lifetime, because the memory of blocks is never moved or freed. Lookups go through
+	// an open addressing hash table of ids.
+	struct string_pool
+	{
+		static const size_t block_size = 1 << 20;
+
+		dynamic_array<buffer> _blocks;
+		char* _arena;
+		size_t _block_used;
+		dynamic_array<const_array_view<char>> _strings;
+		dynamic_array<uint64_t> _hashes;
+		array<uint32_t> _table;
+
+		string_pool() : _arena(nullptr), _block_used(block_size), _table(64) { for (size_t s = 0; s < _table.size(); ++s) _table[s] = UINT32_MAX; }
+
+		size_t size() const { return _strings.size(); }
+		const_array_view<char> operator[](uint32_t id) const { return _strings[id]; }
+
+		// Returns the id of a string, adding it to the pool if it is new
+		uint32_t intern(const_array_view<char> s) { return intern(s, detail::hash_bytes(s.begin(), s.size())); }
+		uint32_t intern(const std::string& s) { return intern(string_view(s)); }
+
+		// Returns the id of a string, or UINT32_MAX if it is not in the pool
+		uint32_t find(const_array_view<char> s) const { return find(s, detail::hash_bytes(s.begin(), s.size())); }
+
+		// Variants that take the hash of the string, for callers that have already computed it
+		uint32_t find(const_array_view<char> s, uint64_t hash) const
+		{
+			for (size_t slot = hash & (_table.size() - 1); ; slot = (slot + 1) & (_table.size() - 1)) {
+				const uint32_t id = _table[slot];
+				if (id == UINT32_MAX) return UINT32_MAX;
+				if (_hashes[id] == hash && _strings[id] == s) return id;
+			}
+		}
+
+		uint32_t intern(const_array_view<char> s, uint64_t hash)
+		{
+			size_t slot = hash & (_table.size() - 1);
+			for (; _table[slot] != UINT32_MAX; slot = (slot + 1) & (_table.size() - 1)) {
+				const uint32_t id = _table[slot];
+				if (_hashes[id] == hash && _strings[id] == s) return id;
+			}
+			const uint32_t id = (uint32_t)_strings.size();
+			_strings.push_back(store(s));
+			_hashes.push_back(hash);
+			_table[slot] = id;
+			// Keep the table at most half full
+			if (_strings.size() * 2 > _table.size()) rehash(_table.size() * 2);
+			return id;
+		}
+
+	private:
+		const_array_view<char> store(const_array_view<char> s)
+		{
+			if (s.size() > block_size / 4) {
+				// Large strings get a block of their own, so they do not waste the rest of the current arena block,
+				// which stays the one that small strings are added to
+				buffer b(s.size());
+				std::memcpy(b.begin(), s.begin(), s.size());
+				const char* data = (const char*)b.begin();
+				_blocks.push_back(static_cast<buffer&&>(b));
+				return const_array_view<char>(data, s.size());
+			}
+			if (_block_used + s.size() > block_size) {
+				buffer b(block_size);
+				_arena = (char*)b.begin();
+				_blocks.push_back(static_cast<buffer&&>(b));
+				_block_used = 0;
+			}
+			char* dest = _arena + _block_used;
+			if (s.size()) std::memcpy(dest, s.begin(), s.size());
+			_block_used += s.size();
+			return const_array_view<char>(dest, s.size());
+		}
+
+		void rehash(size_t capacity)
+		{
+			array<uint32_t> table(capacity);
+			for (size_t slot = 0; slot < capacity; ++slot) table[slot] = UINT32_MAX;
+			for (uint32_t id = 0; id < _strings.size(); ++id) {
+				size_t slot = _hashes[id] & (capacity - 1);
+				while (table[slot] != UINT32_MAX) slot = (slot + 1) & (capacity - 1);
+				table[slot] = id;
+			}
+			_table = static_cast<array<uint32_t>&&>(table);
+		}
+	};
+
+	// A string pool that many threads can intern into at once, such as parallel file parsers. Strings are spread over
+	// independently locked shards by their hash, so threads rarely wait on each other, and the hash is computed outside
+	// of the lock. The low bits of an id name its shard.
+	struct concurrent_string_pool
+	{
+		static const size_t shard_bits = 6;
+		static const size_t shard_count = (size_t)1 << shard_bits;
+
+		struct shard
+		{
+			mutable std::mutex lock;
+			string_pool pool;
+			char pad[cache_line_size];
+		};
+
+		array<shard> _shards;
+
+		concurrent_string_pool() : _shards(shard_count) { }
+
+		size_t size() const
+		{
+			size_t n = 0;
+			for (size_t i = 0; i < shard_count; ++i) {
+				std::lock_guard<std::mutex> guard(_shards[i].lock);
+				n += _shards[i].pool.size();
+			}
+			return n;
+		}
+
+		// Returns the id of a string, adding it to the pool if it is new. Safe to call from any thread.
+		uint32_t intern(const_array_view<char> s)
+		{
+			const uint64_t hash = detail::hash_bytes(s.begin(), s.size());
+			const size_t i = (size_t)(hash >> (64 - shard_bits));
+			std::lock_guard<std::mutex> guard(_shards[i].lock);
+			return (uint32_t)(_shards[i].pool.intern(s, hash) << shard_bits | i);
+		}
+
+		uint32_t intern(const std::string& s) { return intern(string_view(s)); }
+
+		// Returns the id of a string, or UINT32_MAX if it is not in the pool
+		uint32_t find(const_array_view<char> s) const
+		{
+			const uint64_t hash = detail::hash_bytes(s.begin(), s.size());
+			const size_t i = (size_t)(hash >> (64 - shard_bits));
+			std::lock_guard<std::mutex> guard(_shards[i].lock);
+			const uint32_t id = _shards[i].pool.find(s, hash);
+			return id == UINT32_MAX ? id : (uint32_t)(id << shard_bits | i);
+		}
+
+		// Returns the characters of an interned string. The view stays valid for the lifetime of the pool.
+		const_array_view<char> operator[](uint32_t id) const
+		{
+			const shard& sh = _shards[id & (shard_count - 1)];
+			std::lock_guard<std::mutex> guard(sh.lock);
+			return sh.pool[id >> shard_bits];
+		}
+	};
+}